@@ -26,6 +26,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "mpim.h"
 #include <string.h>
 
+// Return a buffer of n chars holding the size chars of sz, zero past them,
+// and free sz.
+static char* Grow(char* sz, int size, int n)
+{
+    char* p = new char[n]();
+    if(sz != 0)
+    {
+        memcpy(p, sz, size);
+        delete[] sz;
+    }
+
+    return p;
+}
+
 int main()
 {
     cout << "Calculating . . .\n";
@@ -38,16 +52,15 @@ int main()
     MPI mTerm;
     int n;
     int j;
-    char szCurr[5000]; // decimal representation current computed value
-    char szLast[5000]; // decimal representation last computed value
+    int size = 1;      // chars in each decimal buffer
+    char* szCurr = new char[size](); // decimal representation current computed value
+    char* szLast = new char[size](); // decimal representation last computed value
     char *p1, *p2;
     enum
     {
         OFFSET = 1200
     }; // number of decimal digits in offset, (adjust this as needed)
 
-    memset(szCurr, 0, sizeof(szCurr));
-    memset(szLast, 0, sizeof(szCurr));
     n = 1;
 
     mOffset = 1;
@@ -69,6 +82,13 @@ int main()
         mTerm = mOffset / mNFact;
         mCurr += mTerm;
 
+        // room for the whole value
+        if(mCurr.StringSize() > size)
+        {
+            szCurr = Grow(szCurr, size, mCurr.StringSize());
+            szLast = Grow(szLast, size, mCurr.StringSize());
+            size = mCurr.StringSize();
+        }
         mCurr.String(szCurr);
 
         if(!(n % 20) || mLast == mCurr)
@@ -88,5 +108,8 @@ int main()
     while(mLast != mCurr);
 
     cout << "Reached limit of calculation capability.\n";
+
+    delete[] szCurr;
+    delete[] szLast;
     return 0;
 }
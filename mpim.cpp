@@ -18,6 +18,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
 #include "mpim.h"
+#include "mpimdiv.h"
+#include "mpimkern.h"
+#include "mpimmod.h"
+#include "mpimmul.h"
+#include "mpimpool.h"
+#include "mpimscr.h"
 #include <cstring>
 
 /*****************************************************************************/
@@ -25,34 +31,74 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 /*****************************************************************************/
 
 // Construct and initialize to zero.
+// Zero has no significant digits, so nothing is allocated.
 MPI::MPI()
 {
-    Zero();
+    mArray = 0;
+    mSize = 0;
+    mAlloc = 0;
+    mIsOverflow = false;
 }
 
-// Initialize value to zero.
-void MPI::Zero()
+// Copy constructor.
+MPI::MPI(const MPI& m)
 {
-    int i;
-    for(i=0; i<MAX_ARRAY; ++i)
+    mArray = 0;
+    mSize = 0;
+    mAlloc = 0;
+    mIsOverflow = m.mIsOverflow;
+
+    // Duplicate the significant digits.
+    Reserve(m.mSize);
+    for(int i=0; i<m.mSize; ++i)
     {
-        mArray[i] = 0;
+        mArray[i] = m.mArray[i];
     }
 
+    mSize = m.mSize;
+}
+
+// Move constructor, takes over the digit storage of m.
+MPI::MPI(MPI&& m)
+{
+    mArray = m.mArray;
+    mSize = m.mSize;
+    mAlloc = m.mAlloc;
+    mIsOverflow = m.mIsOverflow;
+
+    m.mArray = 0;
+    m.mSize = 0;
+    m.mAlloc = 0;
+}
+
+// Release the digit storage.
+MPI::~MPI()
+{
+    delete[] mArray;
+}
+
+// Initialize value to zero.
+// The digit storage is kept for reuse.
+void MPI::Zero()
+{
+    mSize = 0;
     mIsOverflow = false;
 }
 
 // Construct from decimal string representation.
-MPI::MPI(char* psz)
+MPI::MPI(const char* psz)
 {
+    mArray = 0;
+    mSize = 0;
+    mAlloc = 0;
+    mIsOverflow = false;
+
     // Validate input.
     if(psz == 0)
     {
         return;
     }
 
-    Zero();
-
     // For each digit . . .
     while(*psz != 0)
     {
@@ -71,37 +117,78 @@ MPI::MPI(char* psz)
 // Construct from integer.
 MPI::MPI(int n)
 {
-    Zero();
-    mArray[0] = n & (MOD_VALUE-1);
+    mArray = 0;
+    mSize = 0;
+    mAlloc = 0;
+    mIsOverflow = false;
+
+    DIGIT v = (DIGIT)n & DIGIT_MASK;
+    if(v != 0)
+    {
+        Reserve(1);
+        mArray[0] = v;
+        mSize = 1;
+    }
 }
 
 /*****************************************************************************/
 // ASSIGNMENTS
 /*****************************************************************************/
 
-MPI MPI::operator=(const MPI& m)
+MPI& MPI::operator=(const MPI& m)
 {
     // Protect against assigning object to itself.
     if(&m == this) return *this;
 
-    // Duplicate the array.
-    for(int i=0; i<MAX_ARRAY; ++i)
+    // Duplicate the significant digits.
+    Reserve(m.mSize);
+    for(int i=0; i<m.mSize; ++i)
     {
         mArray[i] = m.mArray[i];
     }
 
+    mSize = m.mSize;
+    mIsOverflow = m.mIsOverflow;
+
+    return *this;
+}
+
+// Move assignment, takes over the digit storage of m.
+MPI& MPI::operator=(MPI&& m)
+{
+    if(&m == this) return *this;
+
+    delete[] mArray;
+
+    mArray = m.mArray;
+    mSize = m.mSize;
+    mAlloc = m.mAlloc;
     mIsOverflow = m.mIsOverflow;
 
+    m.mArray = 0;
+    m.mSize = 0;
+    m.mAlloc = 0;
+
     return *this;
 }
 
-MPI MPI::operator=(int n)
+// Assign an integer, reusing the digit storage.
+MPI& MPI::operator=(int n)
 {
-    *this = MPI(n);
+    DIGIT v = (DIGIT)n & DIGIT_MASK;
+
+    Zero();
+    if(v != 0)
+    {
+        Reserve(1);
+        mArray[0] = v;
+        mSize = 1;
+    }
+
     return *this;
 }
 
-MPI MPI::operator=(char* psz)
+MPI& MPI::operator=(const char* psz)
 {
     *this = MPI(psz);
     return *this;
@@ -112,31 +199,17 @@ MPI MPI::operator=(char* psz)
 /*****************************************************************************/
 
 // Add MPI + MPI.
-// Algorithm based on Menezes, 14.7, p. 594.
-MPI MPI::operator+(const MPI& m) const
+// The sum is evaluated when it is assigned, see MPI::Evaluate.
+MPISum<2> MPI::operator+(const MPI& m) const
 {
-    MPI w;    // result
-    int carry = 0;
-
-    for(int i=0; i<MAX_ARRAY; ++i)
-    {
-        // Add current digits.
-        w.mArray[i] = mArray[i] + m.mArray[i] + carry;
+    MPISum<2> w;
 
-        // Test for digit overflow.
-        if(w.mArray[i] & MOD_VALUE)
-        {
-            w.mArray[i] -= MOD_VALUE;
-            carry = 1;
-        }
-        else
-        {
-            carry = 0;
-        }
-    }
-
-    // If still carry, whole result is overflow.
-    w.mIsOverflow |= (carry != 0);
+    w.mTerm[0].mValue = this;
+    w.mTerm[0].mMult = 1;
+    w.mTerm[0].mIsNeg = false;
+    w.mTerm[1].mValue = &m;
+    w.mTerm[1].mMult = 1;
+    w.mTerm[1].mIsNeg = false;
 
     return w;
 }
@@ -146,72 +219,133 @@ MPI MPI::operator+(const MPI& m) const
 MPI MPI::operator+(int n) const
 {
     MPI w;
+    int k = Size();
+
+    w.Reserve(k+1);
+    w.mArray[k] = DigitsAdd1(w.mArray, mArray, k, (DIGIT)n & DIGIT_MASK);
+    w.mSize = k+1;
+    w.Normalize();
 
-    n = n & (MOD_VALUE-1);
+    return w;
+}
 
-    // Add argument digit.
-    w.mArray[0] = mArray[0] + n;
+// Subtract MPI - MPI.
+// The difference is evaluated when it is assigned, see MPI::Evaluate.
+MPISum<2> MPI::operator-(const MPI& m) const
+{
+    MPISum<2> w = *this + m;
+    w.mTerm[1].mIsNeg = true;
+    return w;
+}
 
-    // Digit overflow?
-    int carry = 0;
-    if(w.mArray[0] & MOD_VALUE)
+// Set to the sum of k terms, each a value times a digit, added or
+// subtracted. Any term may be this MPI itself.
+// If the result would be negative, it wraps modulo the width of the largest
+// term and the overflow flag is set.
+// Algorithm based on Menezes, 14.7 and 14.9, p. 594, with every term
+// accumulated per digit position in one pass.
+void MPI::Evaluate(const MPITerm* t, int k)
+{
+    int n = 0;
+    for(int j=0; j<k; ++j)
     {
-        w.mArray[0] -= MOD_VALUE;
-        carry = 1;
+        if(n < t[j].mValue->mSize)
+        {
+            n = t[j].mValue->mSize;
+        }
     }
 
-    // Copy all other digits, propagating possible carry.
-    for(int i=1; i<MAX_ARRAY; ++i)
+    // Plain a + b and a - b use the kernels. Terms are read through their
+    // MPI, so growing this one first is safe even if it is also a term.
+    if(k == 2 && t[0].mMult == 1 && t[1].mMult == 1 && !t[0].mIsNeg)
     {
-        // Copy digit, add carry.
-        w.mArray[i] = mArray[i] + carry;
+        const MPI* a = t[0].mValue;
+        const MPI* b = t[1].mValue;
 
-        // Test for digit overflow.
-        if(w.mArray[i] & MOD_VALUE)
+        if(!t[1].mIsNeg)
         {
-            w.mArray[i] -= MOD_VALUE;
-            carry = 1;
+            if(a->mSize < b->mSize)
+            {
+                a = t[1].mValue;
+                b = t[0].mValue;
+            }
+
+            int bn = b->mSize;
+            Reserve(n+1);
+            mArray[n] = DigitsAdd(mArray, a->mArray, n, b->mArray, bn);
+            mIsOverflow = false;
+            mSize = n+1;
+            Normalize();
+            return;
         }
-        else
+
+        // A shorter minuend always goes negative, which the general
+        // loop below wraps.
+        if(a->mSize >= b->mSize)
         {
-            carry = 0;
+            int bn = b->mSize;
+            Reserve(n);
+            DIGIT borrow = DigitsSub(mArray, a->mArray, n, b->mArray, bn);
+            mIsOverflow = (borrow != 0);
+            mSize = n;
+            Normalize();
+            return;
         }
     }
 
-    // If carry still exists, whole result is an overflow.
-    w.mIsOverflow |= (carry != 0);
-
-    return w;
-}
+    // Record sizes before this MPI changes.
+    int size[16];
+    int* sz = (k <= 16) ? size : new int[k];
+    for(int j=0; j<k; ++j)
+    {
+        sz[j] = t[j].mValue->mSize;
+    }
 
-// Subtract MPI - MPI.
-// Algorithm based on Menezes, 14.9, p. 595.
-MPI MPI::operator-(const MPI& m) const
-{
-    MPI w;
-    int carry = 0;
+    // Each product splits into a low half for this position and a high
+    // half carried to the next, so the signed accumulator never overflows.
+    Reserve(n+2);
 
-    for(int i=0; i<MAX_ARRAY; ++i)
+    SDDIGIT carry = 0;
+    SDDIGIT next = 0;
+    for(int i=0; i<n+2; ++i)
     {
-        // Subtract current digits.
-        w.mArray[i] = mArray[i] - m.mArray[i] - carry;
+        SDDIGIT acc = carry + next;
+        next = 0;
 
-        // Test for digit overflow.
-        if(w.mArray[i] & MOD_VALUE)
+        for(int j=0; j<k; ++j)
         {
-            w.mArray[i] += MOD_VALUE;
-            carry = 1;
-        }
-        else
-        {
-            carry = 0;
+            if(i < sz[j])
+            {
+                DDIGIT p = (DDIGIT)t[j].mValue->mArray[i] * t[j].mMult;
+                SDDIGIT lo = (SDDIGIT)(p & DIGIT_MASK);
+                SDDIGIT hi = (SDDIGIT)(p >> SHIFT_VALUE);
+
+                if(t[j].mIsNeg)
+                {
+                    acc -= lo;
+                    next -= hi;
+                }
+                else
+                {
+                    acc += lo;
+                    next += hi;
+                }
+            }
         }
+
+        mArray[i] = (DIGIT)((DDIGIT)acc & DIGIT_MASK);
+        carry = acc >> SHIFT_VALUE;
     }
 
-    // If carry still exists, whole result is an overflow.
-    w.mIsOverflow |= (carry != 0);
+    if(sz != size)
+    {
+        delete[] sz;
+    }
 
-    return w;
+    // A negative result keeps only the width of the largest term.
+    mIsOverflow = (carry < 0);
+    mSize = mIsOverflow ? n : n+2;
+    Normalize();
 }
 
 // Subtract MPI - int.
@@ -219,39 +353,21 @@ MPI MPI::operator-(const MPI& m) const
 MPI MPI::operator-(int n) const
 {
     MPI w;
+    DIGIT zero = 0;
+    const DIGIT* a = mArray;
+    int k = Size();
 
-    n = n & (MOD_VALUE-1);
-
-    // Subtract argument digit.
-    w.mArray[0] = mArray[0] - n;
-
-    // Digit overflow?
-    int carry = 0;
-    if(w.mArray[0] & MOD_VALUE)
-    {
-        w.mArray[0] += MOD_VALUE;
-        carry = 1;
-    }
-
-    for(int i=1; i<MAX_ARRAY; ++i)
+    // Zero wraps within one digit.
+    if(k == 0)
     {
-        // Subtract current digits.
-        w.mArray[i] = mArray[i] - carry;
-
-        // Test for digit overflow.
-        if(w.mArray[i] & MOD_VALUE)
-        {
-            w.mArray[i] += MOD_VALUE;
-            carry = 1;
-        }
-        else
-        {
-            carry = 0;
-        }
+        a = &zero;
+        k = 1;
     }
 
-    // If carry still exists, whole result is an overflow.
-    w.mIsOverflow |= (carry != 0);
+    w.Reserve(k);
+    w.mIsOverflow = (DigitsSub1(w.mArray, a, k, (DIGIT)n & DIGIT_MASK) != 0);
+    w.mSize = k;
+    w.Normalize();
 
     return w;
 }
@@ -260,19 +376,25 @@ MPI MPI::operator-(int n) const
 // MULTIPLICATION
 /*****************************************************************************/
 
-#define BREAK_EVEN 150
-
-// Recursize multiply controller.
+// Multiply MPI * MPI, method chosen by size, see DigitsMulN. x * x is
+// squared, see DigitsSqrN.
 MPI MPI::operator*(const MPI& y) const
 {
-    if(Size() < BREAK_EVEN || y.Size() < BREAK_EVEN)
-    {
-        return MultSmpl(y);
-    }
-    else
+    MPI w;  // result
+
+    // Anything times zero.
+    if(mSize == 0 || y.mSize == 0)
     {
-        return MultDC(y);
+        return w;
     }
+
+    w.Reserve(mSize + y.mSize);
+    DigitsMulN(w.mArray, mArray, mSize, y.mArray, y.mSize);
+
+    w.mSize = mSize + y.mSize;
+    w.Normalize();
+
+    return w;
 }
 
 // Multiply MPI * MPI.
@@ -281,37 +403,40 @@ MPI MPI::MultSmpl(const MPI& y) const
 {
     MPI w;  // result
 
-    INT64 uv; // double the precision of single digit
-    INT64 carry;
-
     int n = Size();   // Get # digits in x.
     int t = y.Size(); // Get # digits in y.
 
-    for(int i=0; i<t; ++i)
+    // Anything times zero.
+    if(n == 0 || t == 0)
     {
-        carry = 0;
+        return w;
+    }
 
-        int j;
-        for(j=0; j<n; ++j)
-        {
-            if(i+j > MAX_ARRAY-1)
-                continue;
+    w.Reserve(n+t);
+    DigitsMul(w.mArray, mArray, n, y.mArray, t);
 
-            uv = (INT64)w.mArray[i+j] + (INT64)mArray[j] * (INT64)y.mArray[i] + carry;
-            w.mArray[i+j] = (INT32)(uv & (MOD_VALUE-1));  // LOWORD.
-            carry = ((uv >> SHIFT_VALUE) & (MOD_VALUE-1));  // HIWORD.
-        }
+    w.mSize = n+t;
+    w.Normalize();
 
-        if(i+j < MAX_ARRAY)
-        {
-            w.mArray[i+j] += (INT32)carry;
-        }
-        else if(carry > 0)
-        {
-            w.mIsOverflow = true;
-        }
+    return w;
+}
+
+// Square MPI, method chosen by size, see DigitsSqrN.
+MPI MPI::Square() const
+{
+    MPI w;  // result
+
+    if(mSize == 0)
+    {
+        return w;
     }
 
+    w.Reserve(2*mSize);
+    DigitsSqrN(w.mArray, mArray, mSize);
+
+    w.mSize = 2*mSize;
+    w.Normalize();
+
     return w;
 }
 
@@ -322,24 +447,12 @@ MPI MPI::operator*(int y) const
     MPI w;  // result
     int n;  // # digits in x
 
-    INT64 uv; // double the precision of single digit
-    INT64 carry;
+    n = Size();   // Get # digits in x.
 
-    n = Size()+1;   // Get # digits in x + 1.
-    y = y & (MOD_VALUE-1);
-    carry = 0;
-
-    for(int j=0; j<n; ++j)
-    {
-        uv = (INT64)mArray[j] * (INT64)y + carry;
-        w.mArray[j] = (INT32)(uv & (MOD_VALUE-1));   // LOWORD
-        carry = ((uv >> SHIFT_VALUE) & (MOD_VALUE-1)); // HIWORD
-    }
-
-    if(carry > 0)
-    {
-        w.mIsOverflow = true;
-    }
+    w.Reserve(n+1);
+    w.mArray[n] = DigitsMul1(w.mArray, mArray, n, (DIGIT)y & DIGIT_MASK);
+    w.mSize = n+1;
+    w.Normalize();
 
     return w;
 }
@@ -370,7 +483,7 @@ MPI MPI::MultALR(const MPI& m) const
     for(int i=0; i<j; ++i)
     {
         // Sum if odd.
-        if(y.mArray[0] & 1)
+        if(y.Digit(0) & 1)
         {
             w += x;
         }
@@ -383,292 +496,317 @@ MPI MPI::MultALR(const MPI& m) const
 }
 
 // Multiply MPI * MPI, Divide and Conquer.
-// Algorithm based on Brassard, p. 219-223.
+// The top level always splits, see DigitsMulKara; smaller products are
+// chosen by size. Operands of very different length multiply as usual.
 MPI MPI::MultDC(const MPI& m) const
 {
-    MPI d;           // result product
-    MPI w, x, y, z;  // split pieces of the arguments
-    MPI p, q, r;     // intermediate products
-    int f, h;        // full and half size of arguements
+    MPI w;  // result
 
-    f = Largest(m)-1;
-    h = f/2;
+    const MPI* a = this; // longer argument
+    const MPI* b = &m;   // shorter argument
 
-    // Assign w.
-    for(int i=h; i<f; ++i)
+    if(a->mSize < b->mSize)
     {
-        w.mArray[i-h] = mArray[i];
+        a = &m;
+        b = this;
     }
 
-    // Assign x.
-    for(int i=0; i<h; ++i)
+    // Anything times zero.
+    if(b->mSize == 0)
     {
-        x.mArray[i] = mArray[i];
+        return w;
     }
 
-    // Assign y.
-    for(int i=h; i<f; ++i)
+    int n = a->mSize + b->mSize;
+
+    w.Reserve(n);
+    if(b->mSize > (a->mSize+1)/2)
     {
-        y.mArray[i-h] = m.mArray[i];
+        DigitsMulKara(w.mArray, a->mArray, a->mSize, b->mArray, b->mSize);
     }
-
-    // Assign z.
-    for(int i=0; i<h; ++i)
+    else
     {
-        z.mArray[i] = m.mArray[i];
+        DigitsMulN(w.mArray, a->mArray, a->mSize, b->mArray, b->mSize);
     }
+    w.mSize = n;
+    w.Normalize();
 
-    // Calculate three products.
-    p = w * y;
-    q = x * z;
-    r = (w + x) * (y + z);
-
-    d = p;
-    d.ShiftLeft(h);
-
-    d += r - p - q;
-    d.ShiftLeft(h);
-
-    d += q;
-
-    return d;
+    return w;
 }
 
 /*****************************************************************************/
 // DIVISION AND MODULUS
 /*****************************************************************************/
 
-// Divide MPI / MPI, Classical.
-// Algorithm based on Knuth, D, p. 257.
-MPI MPI::operator/(const MPI& m) const
+// Divide digit vectors, where na >= nb and b[nb-1] is not zero.
+// Writes na-nb+1 quotient digits to q, and nb remainder digits to r.
+// Either may be null if it is not wanted.
+// Both arguments are copied before anything is written, so q and r may
+// overlap them. Temporaries come from the scratch arena.
+// The method is chosen by size, see DigitsDivN.
+static void DivSpans(DIGIT* q, DIGIT* r, const DIGIT* a, int na,
+                     const DIGIT* b, int nb)
 {
-    MPI u;    // dividend
-    MPI v;    // divisor
-    MPI q;    // quotient
-    MPI s;    // trial subtract amount
-    INT32 qh; // trial quotient
-    INT32 d;  // normalization factor
+    ScratchMark mark;
 
-    // Work with local copies
-    u = *this;
-    v = m;
+    // Normalize so the top bit of the divisor is set. The digit shifted
+    // out of the dividend is then below the top digit of the divisor.
+    int d = SHIFT_VALUE - DigitBits(b[nb-1]);
+    DIGIT* u = ScratchAlloc(na+1);
+    DIGIT* v = ScratchAlloc(nb);
+    u[na] = DigitsShl(u, a, na, d);
+    DigitsShl(v, b, nb, d);
 
-#if 0
-    if(u.Size() == 0)
-        return MPI(0);
-
-    if(v.Size() == 0)
+    if(q == 0)
     {
-        q.mIsOverflow = true;
-        return q;
+        q = ScratchAlloc(na-nb+1);
     }
-#endif
-
-    // Normalize.
-    d = MOD_VALUE / (v.MSDigit() + 1);
-    u *= (int)d;
-    v *= (int)d;
 
-    // Get # digits.
-    int t = v.Size();
-    int n = u.Size();
+    // Main calculation.
+    DigitsDivN(q, u, na+1, v, nb);
 
-    // Main calculation loop.
-    for(int j=n; j>=t; --j)
+    // Un-normalize the remainder.
+    if(r != 0)
     {
-        // Calculate trial quotient.
-        qh = (((INT64)u.mArray[j] * MOD_VALUE) + u.mArray[j-1]) / v.mArray[t-1];
-
-        // Adjust quotient if too large.
-        if(qh & MOD_VALUE)
-            qh = MOD_VALUE -1;
+        DigitsShr(r, u, nb, d);
+    }
+}
 
-        // Multiply and subtract.
-        s = v;
-        s.ShiftLeft(j-t);
-        u -= s * qh;
+// Quotient and remainder in one division. Either output may be null if
+// it is not wanted, and either may be this or the divisor; q and r must
+// not be the same MPI.
+void MPI::DivMod(const MPI& m, MPI* q, MPI* r) const
+{
+    // Division by zero.
+    if(m.mSize == 0)
+    {
+        if(q != 0)
+        {
+            q->Zero();
+            q->mIsOverflow = true;
+        }
+        if(r != 0)
+        {
+            r->Zero();
+            r->mIsOverflow = true;
+        }
+        return;
+    }
 
-        // Adjust result if it went negative.
-        while(u.mArray[MAX_ARRAY-1] == MOD_VALUE-1)
+    // Quotient is zero and the remainder is the dividend when the divisor
+    // is larger.
+    if(mSize < m.mSize)
+    {
+        if(r != 0 && r != this)
         {
-            --qh;   // Adjust quotient digit.
-            u += s; // Add back.
-            u.mIsOverflow = false;
+            *r = *this;
         }
+        if(q != 0)
+        {
+            q->Zero();
+        }
+        return;
+    }
 
-        // Set the quotient digit we just found.
-        q.mArray[j-t] = qh;
+    int n = mSize;
+    int t = m.mSize;
+
+    // Reserving keeps the digits, so the arrays are read after it in case
+    // an output is also an argument.
+    if(q != 0)
+    {
+        q->Reserve(n-t+1);
+    }
+    if(r != 0)
+    {
+        r->Reserve(t);
+    }
+
+    DivSpans(q ? q->mArray : 0, r ? r->mArray : 0, mArray, n, m.mArray, t);
+
+    if(q != 0)
+    {
+        q->mSize = n-t+1;
+        q->mIsOverflow = false;
+        q->Normalize();
     }
+    if(r != 0)
+    {
+        r->mSize = t;
+        r->mIsOverflow = false;
+        r->Normalize();
+    }
+}
 
+// Divide MPI / MPI.
+MPI MPI::operator/(const MPI& m) const
+{
+    MPI q;    // quotient
+    DivMod(m, &q, 0);
     return q;
 }
 
 // Divide MPI / int.
-// Algorithm based on Knuth, D, p. 257.
 MPI MPI::operator/(int y) const
 {
-    MPI u;    // dividend
-    INT32 v;  // divisor
-    MPI q;    // quotient
-    MPI s;    // trial subtract amount
-    INT32 qh; // trial quotient
-    INT32 d;  // normalization factor
-
-    // Work with local copies.
-    u = *this;
-    v = y & (MOD_VALUE-1);
-
-    // Normalize.
-    d = MOD_VALUE / (v + 1);
-    u *= (int)d;
-    v *= (int)d;
+    return *this / MPIDivisor((DIGIT)y);
+}
 
-    // Get # digits.
-    int n = u.Size(); // # digits in u.
+// Divide MPI / digit, with its reciprocal.
+MPI MPI::operator/(const MPIDivisor& d) const
+{
+    MPI q;    // quotient
 
-    // Main calculation loop.
-    for(int j=n; j>=1; --j)
+    // Division by zero.
+    if(d.mDivisor == 0)
     {
-        // Calculate trial quotient.
-        qh = (((INT64)u.mArray[j] * MOD_VALUE) + u.mArray[j-1]) / v;
-
-        // Adjust quotient if too large.
-        if(qh & MOD_VALUE)
-            qh = MOD_VALUE -1;
-
-        // Multiply and subtract.
-        s = v;
-        s.ShiftLeft(j-1);
-        u -= s * qh;
+        q.mIsOverflow = true;
+        return q;
+    }
 
-        // Adjust result if it went negative.
-        while(u.mArray[MAX_ARRAY-1] == MOD_VALUE-1)
-        {
-            --qh;   // Adjust quotient digit.
-            u += s; // Add back.
-            u.mIsOverflow = false;
-        }
+    int n = Size(); // # digits in dividend.
 
-        // Set the quotient digit we just found.
-        q.mArray[j-1] = qh;
-    }
+    q.Reserve(n);
+    DigitsDivRem1(q.mArray, mArray, n, d);
+    q.mSize = n;
+    q.Normalize();
 
     return q;
 }
 
 // Modulus, MPI % MPI.
-// Algorithm based on Knuth, D, p. 257.
 MPI MPI::operator%(const MPI& m) const
 {
-    MPI u;    // dividend
-    MPI v;    // divisor
-    MPI s;    // trial subtract amount
-    INT32 qh; // trial quotient
-    INT32 d;  // normalization factor
-
-    // Work with local copies.
-    u = *this;
-    v = m;
+    MPI r;    // remainder
+    DivMod(m, 0, &r);
+    return r;
+}
 
-    // Normalize.
-    d = MOD_VALUE / (v.MSDigit() + 1);
-    u *= (int)d;
-    v *= (int)d;
+// Modulus MPI % int.
+MPI MPI::operator%(int n) const
+{
+    return *this % MPIDivisor((DIGIT)n);
+}
 
-    // Get # digits.
-    int t = v.Size(); // # digits in u.
-    int n = u.Size(); // # digits in v.
+// Modulus MPI % digit, with its reciprocal.
+MPI MPI::operator%(const MPIDivisor& d) const
+{
+    MPI r;    // remainder
 
-    // Main calculation loop.
-    for(int j=n; j>=t; --j)
+    // Division by zero.
+    if(d.mDivisor == 0)
     {
-        // Calculate trial quotient, get LOWORD.
-        qh = (((INT64)u.mArray[j] * MOD_VALUE) + u.mArray[j-1]) / v.mArray[t-1];
-
-        // Adjust quotient if too large.
-        if(qh & MOD_VALUE)
-            qh = MOD_VALUE -1;
-
-        // Multiply and subtract.
-        s = v;
-        s.ShiftLeft(j-t);
-        u -= s * qh;
-
-        // Adjust result if it went negative.
-        while(u.mArray[MAX_ARRAY-1] == MOD_VALUE-1)
-        {
-            u += s; // Add back.
-        }
+        r.mIsOverflow = true;
+        return r;
     }
 
-    // Un-normalize.
-    u /= d;
+    ScratchMark mark;
+    DIGIT* q = ScratchAlloc(Size());
 
-    // Fix flag if it ever went negative.
-    u.mIsOverflow = false;
+    r.Reserve(1);
+    r.mArray[0] = DigitsDivRem1(q, mArray, Size(), d);
+    r.mSize = 1;
+    r.Normalize();
 
-    return u;  // The remainder.
+    return r;
 }
 
-// Modulus MPI % int.
-MPI MPI::operator%(int n) const
+// Modulus MPI % prepared modulus, see MPIModulus.
+MPI MPI::operator%(const MPIModulus& m) const
 {
-    return *this % MPI(n);
+    MPI r = *this;
+    m.Reduce(r);
+    return r;
 }
 
 // Division, Quotient and Remainder, MPI / MPI.
-// Algorithm based on Knuth, D, p. 257.
-MPI MPI::Divide(const MPI& v1, MPI& u) const
+// The remainder may be the dividend or the divisor itself.
+MPI MPI::Divide(const MPI& v, MPI& u) const
 {
     MPI q;    // quotient
-    MPI v;    // divisor
-    MPI s;    // trial subtract amount
-    INT32 qh; // trial quotient
-    INT32 d;  // normalization factor
+    DivMod(v, &q, &u);
+    return q;
+}
 
-    // Work with local copies.
-    u = *this;
-    v = v1;
+// Division, Quotient and Remainder, MPI / digit, in one pass.
+MPI MPI::Divide(const MPIDivisor& d, DIGIT& r) const
+{
+    MPI q;    // quotient
 
-    // Normalize.
-    d = MOD_VALUE / (v.MSDigit() + 1);
-    u *= (int)d;
-    v *= (int)d;
+    // Division by zero.
+    if(d.mDivisor == 0)
+    {
+        r = 0;
+        q.mIsOverflow = true;
+        return q;
+    }
 
-    // Get # digits.
-    int t = v.Size(); // # digits in u.
-    int n = u.Size(); // # digits in v.
+    int n = Size();
 
-    // Main calculation loop.
-    for(int j=n; j>=t; --j)
-    {
-        // Calculate trial quotient, get LOWORD.
-        qh = (((INT64)u.mArray[j] * MOD_VALUE) + u.mArray[j-1]) / v.mArray[t-1];
+    q.Reserve(n);
+    r = DigitsDivRem1(q.mArray, mArray, n, d);
+    q.mSize = n;
+    q.Normalize();
 
-        // Adjust quotient if too large.
-        if(qh & MOD_VALUE)
-            qh = MOD_VALUE -1;
+    return q;
+}
 
-        // Multiply and subtract.
-        s = v;
-        s.ShiftLeft(j-t);
-        u -= s * qh;
+// Exact division, MPI / MPI, when the remainder is known to be zero.
+// Common factors of two are shifted out of both, leaving an odd divisor
+// for Hensel division, see DigitsDivExact. If the division is not exact
+// the result is meaningless.
+MPI MPI::DivExact(const MPI& m) const
+{
+    MPI q;    // quotient
 
-        // Adjust result if it went negative.
-        while(u.mArray[MAX_ARRAY-1] == MOD_VALUE-1)
-            u += s; // Add back.
+    // Division by zero.
+    if(m.mSize == 0)
+    {
+        q.mIsOverflow = true;
+        return q;
+    }
 
-        // Set the quotient digit we just found.
-        q.mArray[j-t] = qh;
+    // Only zero is divisible by a larger divisor.
+    if(mSize < m.mSize)
+    {
+        return q;
     }
 
-    // Un-normalize.
-    u /= d;
+    // Low zero digits, then bits, of the divisor.
+    int z = 0;
+    while(m.mArray[z] == 0)
+    {
+        ++z;
+    }
+    DIGIT low = m.mArray[z];
+    int s = DigitBits(low & ((DIGIT)0 - low)) - 1;
+
+    ScratchMark mark;
+    int na = mSize-z;
+    int nb = m.mSize-z;
+    DIGIT* a = ScratchAlloc(na);
+    DIGIT* b = ScratchAlloc(nb);
+    DigitsShr(a, mArray+z, na, s);
+    DigitsShr(b, m.mArray+z, nb, s);
+    if(b[nb-1] == 0)
+    {
+        --nb;
+    }
+    while(na > 0 && a[na-1] == 0)
+    {
+        --na;
+    }
+
+    if(na < nb)
+    {
+        return q;
+    }
 
-    // Fix flag if it ever went negative.
-    u.mIsOverflow = false;
+    q.Reserve(na-nb+1);
+    DigitsDivExact(q.mArray, a, na, b, nb);
+    q.mSize = na-nb+1;
+    q.Normalize();
 
-    // Remainder is returned in u.
     return q;
 }
 
@@ -676,40 +814,99 @@ MPI MPI::Divide(const MPI& v1, MPI& u) const
 // EXPONENTS AND MODULAR ARITHMETIC
 /*****************************************************************************/
 
-// Exponential MPI ^ MPI.
-// Algorithm based on CLR, p. 829.
-MPI MPI::operator^(const MPI& y) const
+// Widest exponent window, see WindowBits.
+#define MAX_WINDOW 6
+
+// Window width for an exponent of n bits. Each extra bit doubles the table
+// of odd powers, and pays for it only on longer exponents.
+static int WindowBits(int n)
 {
-    MPI w;  // return value
-    MPI s;  // shifted exponent
-    int n;  // digits in exponent
-    int k;  // bits in exponent
+    if(n > 671) return 6;
+    if(n > 239) return 5;
+    if(n > 79)  return 4;
+    if(n > 23)  return 3;
+    return 1;
+}
 
-    // shifted exponent
-    s = y;
+// Left-to-right sliding window exponentiation. The exponent y, not zero,
+// is read from its top bit down in windows of at most k bits that start
+// and end with a one; zeros between them are single squarings. The caller
+// keeps the result and a table of the odd powers x^(2j+1): first(j) sets
+// the result to entry j, sqr() squares the result, and mul(j) multiplies
+// it by entry j.
+// Algorithm based on Menezes, 14.85, p. 616.
+template<class F, class S, class M>
+static void ScanWindows(const MPI& y, int k, F first, S sqr, M mul)
+{
+    bool isFirst = true;
+    int i = y.Bits()-1;
 
-    // How many times to loop.
-    n = y.Size();
-    k = n * SHIFT_VALUE;
+    while(i >= 0)
+    {
+        if(!y.Bit(i))
+        {
+            sqr();
+            --i;
+            continue;
+        }
 
-    // x ^ 0 = 1.
-    if(!n) return MPI(1);
+        // The longest window from bit i that ends in a one.
+        int l = (i-k+1 > 0) ? i-k+1 : 0;
+        while(!y.Bit(l))
+        {
+            ++l;
+        }
 
-    // Main loop.
-    w = 1;
-    for(int i=0; i<k; ++i)
-    {
-        // Square.
-        w *= w;
+        int v = 0;
+        for(int j=i; j>=l; --j)
+        {
+            v = 2*v + y.Bit(j);
+        }
+
+        if(isFirst)
+        {
+            first(v >> 1);
+            isFirst = false;
+        }
+        else
+        {
+            for(int j=i; j>=l; --j)
+            {
+                sqr();
+            }
+            mul(v >> 1);
+        }
+
+        i = l-1;
+    }
+}
+
+// Exponential MPI ^ MPI, by sliding windows.
+MPI MPI::operator^(const MPI& y) const
+{
+    MPI w;  // return value
 
-        // Multiply.
-        if(s.mArray[n-1] & MOD_VALUE/2)
-            w *= *this;
+    // x ^ 0 = 1.
+    if(y.Size() == 0) return MPI(1);
 
-        // Shift.
-        s.Mult2();
+    // Odd powers.
+    int k = WindowBits(y.Bits());
+    MPI g[1 << (MAX_WINDOW-1)];
+    g[0] = *this;
+    if(k > 1)
+    {
+        MPI x2 = Square();
+        for(int j=1; j<(1 << (k-1)); ++j)
+        {
+            g[j] = g[j-1] * x2;
+        }
     }
 
+    ScanWindows(y, k,
+        [&](int j) { w = g[j]; },
+        [&]() { w *= w; },
+        [&](int j) { w *= g[j]; });
+
     return w;
 }
 
@@ -739,131 +936,399 @@ MPI MPI::ModMult(const MPI& y1, const MPI& m) const
     return w;
 }
 
-// Modular Exponetial, Repeated Squaring.
-// Algorithm based on CLR, p. 829.
-MPI MPI::ModPow(const MPI& y, const MPI& m) const
+// Modular Multiplication, by a prepared modulus.
+MPI MPI::ModMult(const MPI& y1, const MPIModulus& m) const
 {
-    MPI w;  // return value
-    MPI s;  // shifted exponent
-    int n;  // digits in exponent
-    int k;  // bits in exponent
+    MPI w;
+    MPI x;
+    MPI y;
+
+    x = *this;
+    y = y1;
 
-    // Shifted exponent.
-    s = y;
+    m.Reduce(x);
+    m.Reduce(y);
 
-    // How many times to loop.
-    n = y.Size();
-    k = n * SHIFT_VALUE;
+    w = x * y;
+    m.Reduce(w);
+
+    return w;
+}
+
+// Modular Exponetial.
+// The modulus is prepared once for all the reductions, see MPIModulus.
+MPI MPI::ModPow(const MPI& y, const MPI& m) const
+{
+    return ModPow(y, MPIModulus(m));
+}
+
+// Modular Exponetial by a prepared modulus, by sliding windows.
+// An odd modulus works in the Montgomery domain, see MontPow.
+MPI MPI::ModPow(const MPI& y, const MPIModulus& m) const
+{
+    MPI w;  // return value
 
     // x ^ 0 = 1.
-    if(!n) return MPI(1);
+    if(y.Size() == 0) return MPI(1);
+
+    if(m.IsOdd())
+    {
+        return MontPow(y, m);
+    }
 
-    // Main loop.
-    w = 1;
-    for(int i=0; i<k; ++i)
+    // Odd powers, reduced, so every product is of two reduced values.
+    int k = WindowBits(y.Bits());
+    MPI g[1 << (MAX_WINDOW-1)];
+    g[0] = *this;
+    m.Reduce(g[0]);
+    if(k > 1)
     {
-        // Square.
-        w *= w;
-        w %= m;
+        MPI x2 = g[0].Square();
+        m.Reduce(x2);
+        for(int j=1; j<(1 << (k-1)); ++j)
+        {
+            g[j] = g[j-1] * x2;
+            m.Reduce(g[j]);
+        }
+    }
+
+    ScanWindows(y, k,
+        [&](int j) { w = g[j]; },
+        [&]() { w *= w; m.Reduce(w); },
+        [&](int j) { w *= g[j]; m.Reduce(w); });
+
+    return w;
+}
+
+// Modular Exponetial in the Montgomery domain, for an odd modulus and a
+// non-zero exponent, by sliding windows. The result and the odd powers
+// stay in scratch digits of the modulus length throughout, and each step
+// is one Montgomery square or product.
+MPI MPI::MontPow(const MPI& y, const MPIModulus& m) const
+{
+    MPI w;  // return value
+    int t = m.mModulus.mSize;
 
-        // Multiply.
-        if(s.mArray[n-1] & MOD_VALUE/2)
+    const DIGIT* md = m.mModulus.mArray;
+    const DIGIT* mi = m.mInverse.mArray;
+    int ni = m.mInverse.mSize;
+
+    // Odd powers, in the domain; entry j is at g + j*t.
+    ScratchMark mark;
+    int k = WindowBits(y.Bits());
+    int nt = 1 << (k-1);
+    DIGIT* g = ScratchAlloc(nt*t);
+    DIGIT* b = ScratchAlloc(t);  // result so far, in the domain
+
+    MPI x = m.ToMont(*this);
+    for(int i=0; i<t; ++i)
+    {
+        g[i] = x.Digit(i);
+    }
+    if(k > 1)
+    {
+        DigitsMontSqr(b, g, md, t, mi, ni);
+        for(int j=1; j<nt; ++j)
         {
-            w *= *this;
-            w %= m;
+            DigitsMontMul(g+j*t, g+(j-1)*t, b, md, t, mi, ni);
         }
+    }
+
+    ScanWindows(y, k,
+        [&](int j) { for(int i=0; i<t; ++i) b[i] = g[j*t+i]; },
+        [&]() { DigitsMontSqr(b, b, md, t, mi, ni); },
+        [&](int j) { DigitsMontMul(b, b, g+j*t, md, t, mi, ni); });
 
-        // Shift.
-        s.Mult2();
+    // Out of the domain.
+    for(int i=0; i<t; ++i)
+    {
+        g[i] = (i == 0);
     }
+    w.Reserve(t);
+    DigitsMontMul(w.mArray, b, g, md, t, mi, ni);
+    w.mSize = t;
+    w.Normalize();
 
     return w;
 }
 
+// Modular Exponetials w[i] = x[i] ^ y[i] mod m for i < n, on the thread
+// pool. The prepared modulus is shared by every thread; each exponential
+// runs whole on one thread, in that thread's scratch digits. A few ranges
+// per thread even out exponents of different lengths.
+void MPI::ModPowBatch(MPI* w, const MPI* x, const MPI* y, int n,
+                      const MPIModulus& m)
+{
+    int grain = n / (4 * GetThreadCount());
+    if(grain < 1)
+    {
+        grain = 1;
+    }
+
+    ParallelFor(0, n, grain, [=, &m](int lo, int hi)
+    {
+        for(int i=lo; i<hi; ++i)
+        {
+            w[i] = x[i].ModPow(y[i], m);
+        }
+    });
+}
+
+// Modular Exponetial x ^ y mod p q, for distinct odd primes p and q, by
+// the Chinese Remainder Theorem: exponentials modulo p and q with the
+// exponent reduced by p-1 and q-1, joined by Garner's formula. Each is
+// of half the length, so the two cost about a quarter of one modulo
+// p q. If isParallel the one modulo p runs on the thread pool.
+// Algorithm based on Menezes, 14.75, p. 613.
+MPI MPI::ModPowCRT(const MPI& y, const MPI& p, const MPI& q,
+                   bool isParallel) const
+{
+    // x ^ 0 = 1.
+    if(y.Size() == 0) return MPI(1);
+
+    // Exponents from 1 to p-1, so x = 0 mod p still gives 0.
+    MPI yp = (y - 1) % (p - 1) + 1;
+    MPI yq = (y - 1) % (q - 1) + 1;
+
+    MPI wp;
+    MPI wq;
+    {
+        TaskGroup tasks(isParallel);
+        tasks.Run([&] { wp = ModPow(yp, MPIModulus(p)); });
+        wq = ModPow(yq, MPIModulus(q));
+        tasks.Wait();
+    }
+
+    // w = wq + q ((wp - wq) / q mod p).
+    MPI h = p + wp - wq % p;
+    h = h.ModMult(q.ModInverse(p), p);
+
+    return wq + q * h;
+}
+
 /*****************************************************************************/
 // ARITHMETIC SHORTCUT FORMS
 /*****************************************************************************/
 
-MPI MPI::operator+=(const MPI& m)
+// Add in place, growing by at most one digit.
+MPI& MPI::operator+=(const MPI& m)
 {
-    return *this = *this + m;
+    DIGIT carry;
+    int n = Largest(m) - 1;
+
+    Reserve(n+1);
+    if(mSize >= m.mSize)
+    {
+        carry = DigitsAdd(mArray, mArray, mSize, m.mArray, m.mSize);
+    }
+    else
+    {
+        carry = DigitsAdd(mArray, m.mArray, m.mSize, mArray, mSize);
+    }
+
+    mArray[n] = carry;
+    mSize = n + (carry != 0);
+    mIsOverflow = false;
+
+    return *this;
 }
 
-MPI MPI::operator-=(const MPI& m)
+// Subtract in place.
+// If the result would be negative, it wraps as for operator-.
+MPI& MPI::operator-=(const MPI& m)
 {
-    return *this = *this - m;
+    DIGIT borrow;
+    int n = Largest(m) - 1;
+
+    // Zero extend to the width of the larger argument.
+    Reserve(n);
+    for(int i=mSize; i<n; ++i)
+    {
+        mArray[i] = 0;
+    }
+
+    borrow = DigitsSub(mArray, mArray, n, m.mArray, m.mSize);
+
+    mSize = n;
+    mIsOverflow = (borrow != 0);
+    Normalize();
+
+    return *this;
 }
 
-MPI MPI::operator*=(const MPI& m)
+// The product is built in scratch, then copied into the digit storage,
+// so a value that keeps its size needs no new storage. x *= x squares.
+MPI& MPI::operator*=(const MPI& m)
 {
-    return *this = *this * m;
+    if(mSize == 0 || m.mSize == 0)
+    {
+        Zero();
+        mIsOverflow = false;
+        return *this;
+    }
+
+    ScratchMark mark;
+    int n = mSize + m.mSize;
+    DIGIT* w = ScratchAlloc(n);
+
+    DigitsMulN(w, mArray, mSize, m.mArray, m.mSize);
+
+    Reserve(n);
+    for(int i=0; i<n; ++i)
+    {
+        mArray[i] = w[i];
+    }
+
+    mSize = n;
+    mIsOverflow = false;
+    Normalize();
+
+    return *this;
 }
 
-MPI MPI::operator/=(const MPI& m)
+// Divide in place; the quotient is no longer than the dividend.
+MPI& MPI::operator/=(const MPI& m)
 {
-    return *this = *this / m;
+    DivMod(m, this, 0);
+    return *this;
 }
 
-MPI MPI::operator%=(const MPI& m)
+// Reduce in place; the remainder is no longer than the dividend.
+MPI& MPI::operator%=(const MPI& m)
 {
-    return *this = *this % m;
+    DivMod(m, 0, this);
+    return *this;
 }
 
-MPI MPI::operator^=(const MPI& m)
+MPI& MPI::operator^=(const MPI& m)
 {
     return *this = *this ^ m;
 }
 
-MPI MPI::operator+=(int n)
+// Add a digit in place, carrying only as far as needed.
+MPI& MPI::operator+=(int n)
 {
-    return *this = *this + n;
+    Reserve(mSize+1);
+    DIGIT carry = DigitsAdd1(mArray, mArray, mSize, (DIGIT)n & DIGIT_MASK);
+    if(carry)
+    {
+        mArray[mSize++] = carry;
+    }
+
+    mIsOverflow = false;
+    return *this;
 }
 
-MPI MPI::operator-=(int n)
+// Subtract a digit in place, borrowing only as far as needed.
+MPI& MPI::operator-=(int n)
 {
-    return *this = *this - n;
+    // Zero wraps within one digit.
+    if(mSize == 0)
+    {
+        Reserve(1);
+        mArray[0] = 0;
+        mSize = 1;
+    }
+
+    mIsOverflow = (DigitsSub1(mArray, mArray, mSize, (DIGIT)n & DIGIT_MASK) != 0);
+    Normalize();
+
+    return *this;
 }
 
-MPI MPI::operator*=(int n)
+// Multiply by a digit in place, growing by at most one digit.
+MPI& MPI::operator*=(int n)
 {
-    return *this = *this * n;
+    Reserve(mSize+1);
+    mArray[mSize] = DigitsMul1(mArray, mArray, mSize, (DIGIT)n & DIGIT_MASK);
+    ++mSize;
+    mIsOverflow = false;
+    Normalize();
+
+    return *this;
 }
 
-MPI MPI::operator/=(int n)
+// Divide by a digit in place.
+MPI& MPI::operator/=(int n)
 {
-    return *this = *this / n;
+    return *this /= MPIDivisor((DIGIT)n);
 }
 
-MPI MPI::operator%=(int n)
+MPI& MPI::operator/=(const MPIDivisor& d)
 {
-    return *this = *this % n;
+    // Division by zero.
+    if(d.mDivisor == 0)
+    {
+        Zero();
+        mIsOverflow = true;
+        return *this;
+    }
+
+    DigitsDivRem1(mArray, mArray, mSize, d);
+    mIsOverflow = false;
+    Normalize();
+
+    return *this;
 }
 
-MPI MPI::operator^=(int n)
+MPI& MPI::operator%=(int n)
 {
-    return *this = *this ^ n;
+    return *this %= MPIDivisor((DIGIT)n);
 }
 
-MPI MPI::operator++()
+MPI& MPI::operator%=(const MPIDivisor& d)
 {
-    *this = *this + 1;
+    // Division by zero.
+    if(d.mDivisor == 0)
+    {
+        Zero();
+        mIsOverflow = true;
+        return *this;
+    }
+
+    ScratchMark mark;
+    DIGIT* q = ScratchAlloc(mSize);
+
+    DIGIT r = DigitsDivRem1(q, mArray, mSize, d);
+    Reserve(1);
+    mArray[0] = r;
+    mSize = 1;
+    mIsOverflow = false;
+    Normalize();
+
     return *this;
 }
+
+// Reduce in place by a prepared modulus, see MPIModulus.
+MPI& MPI::operator%=(const MPIModulus& m)
+{
+    m.Reduce(*this);
+    return *this;
+}
+
+MPI& MPI::operator^=(int n)
+{
+    return *this = *this ^ n;
+}
+
+MPI& MPI::operator++()
+{
+    return *this += 1;
+}
 MPI MPI::operator++(int)
 {
     MPI m = *this;
-    *this = *this + 1;
+    *this += 1;
     return m;
 }
-MPI MPI::operator--()
+MPI& MPI::operator--()
 {
-    *this = *this - 1;
-    return *this;
+    return *this -= 1;
 }
 MPI MPI::operator--(int)
 {
     MPI m = *this;
-    *this = *this - 1;
+    *this -= 1;
     return m;
 }
 
@@ -871,62 +1336,46 @@ MPI MPI::operator--(int)
 // LOGICAL OPERATORS/ COMPARISON/ SHIFTING
 /*****************************************************************************/
 
-bool MPI::operator<(const MPI& m) const
+// Three-way compare, returns -1, 0 or 1.
+// Sizes decide unless they are equal, then digits from the top down.
+int MPI::Compare(const MPI& m) const
 {
-    MPI x;
+    if(mSize != m.mSize)
+    {
+        return (mSize < m.mSize) ? -1 : 1;
+    }
 
-    x = *this - m;
-    return x.mIsOverflow;
+    return DigitsCmp(mArray, m.mArray, mSize);
 }
 
-bool MPI::operator<=(const MPI& m) const
+bool MPI::operator<(const MPI& m) const
 {
-    MPI x;
+    return Compare(m) < 0;
+}
 
-    x = m - *this;
-    return !x.mIsOverflow;
+bool MPI::operator<=(const MPI& m) const
+{
+    return Compare(m) <= 0;
 }
 
 bool MPI::operator>(const MPI& m) const
 {
-    MPI x;
-
-    x = m - *this;
-    return x.mIsOverflow;
+    return Compare(m) > 0;
 }
 
 bool MPI::operator>=(const MPI& m) const
 {
-    MPI x;
-
-    x = *this - m;
-    return !x.mIsOverflow;
+    return Compare(m) >= 0;
 }
 
 bool MPI::operator==(const MPI& m) const
 {
-    for(int i=0; i<MAX_ARRAY; ++i)
-    {
-        if(m.mArray[i] != mArray[i])
-        {
-            return false;
-        }
-    }
-
-    return true;
+    return Compare(m) == 0;
 }
 
 bool MPI::operator!=(const MPI& m) const
 {
-    for(int i=0; i<MAX_ARRAY; ++i)
-    {
-        if(m.mArray[i] != mArray[i])
-        {
-            return true;
-        }
-    }
-
-    return false;
+    return Compare(m) != 0;
 }
 
 /*****************************************************************************/
@@ -937,39 +1386,77 @@ bool MPI::operator!=(const MPI& m) const
 int MPI::Integer() const
 {
     // If the value is too large, flag an error.
-    if(Size() > 1)
+    if(Size() > 1 || Digit(0) > 0x7FFFFFFF)
     {
         return -1;
     }
 
-    return (int)mArray[0];
+    return (int)Digit(0);
+}
+
+// Number of display places in the largest power of BASE that fits in a
+// digit.
+static constexpr int BasePlaces()
+{
+    int k = 0;
+    for(DIGIT p=BASE; p <= DIGIT_MASK / BASE; p *= BASE)
+    {
+        ++k;
+    }
+
+    return k+1;
+}
+
+// That power, with its reciprocal.
+static constexpr DIGIT BasePower()
+{
+    DIGIT p = 1;
+    for(int k=0; k<BasePlaces(); ++k)
+    {
+        p *= BASE;
+    }
+
+    return p;
 }
 
+static constexpr MPIDivisor BASE_POWER(BasePower());
+
 // Convert to a character string representation in decimal.
+// Divides by BASE_POWER, so each pass gives BasePlaces() chars.
 char* MPI::String(char sz[]) const
 {
-    MPI q;       // quotient
-    MPI r;       // remaider
-    MPI zero;
-    MPI base;
-
     // Don't print invalid number.
-    if(Size() >= MAX_ARRAY || mIsOverflow)
+    if(mIsOverflow)
     {
         strcpy(sz, "ERROR");
         return sz;
     }
 
-    base = BASE;
-    int i = 0;
-    q = *this;
+    ScratchMark mark;
+    DIGIT* q = ScratchAlloc(mSize);
+    int n = mSize;
+    for(int j=0; j<n; ++j)
+    {
+        q[j] = mArray[j];
+    }
 
+    int i = 0;
     do
     {
-        q = q.Divide(base, r);
-        sz[i++] = r.mArray[0] + '0';
+        DIGIT r = DigitsDivRem1(q, q, n, BASE_POWER);
+        while(n > 0 && q[n-1] == 0)
+        {
+            --n;
+        }
+
+        // All the places, except at the top.
+        for(int k=0; k<BasePlaces() && (n > 0 || r > 0 || k == 0); ++k)
+        {
+            sz[i++] = (char)(r % BASE) + '0';
+            r /= BASE;
+        }
     }
-    while(q != zero);
+    while(n > 0);
 
     sz[i] = '\0';
     --i;
@@ -986,23 +1473,32 @@ char* MPI::String(char sz[]) const
     return sz;
 }
 
+// Chars String may write, with the '\0': each digit needs at most
+// SHIFT_VALUE/3 decimal chars, and "ERROR" fits in the rest.
+int MPI::StringSize() const
+{
+    return mSize * SHIFT_VALUE / 3 + 8;
+}
+
 // Stream output.
 ostream& operator<<(ostream& os, MPI& m)
 {
-    char sz[MPI_BUFF];
+    char* sz = new char[m.StringSize()];
 
     m.String(sz);
     os << sz;
+
+    delete[] sz;
     return os;
 }
 
 // Stream input.
 istream& operator>>(istream& is, MPI& m)
 {
-    char sz[MPI_BUFF];
+    string s;
 
-    is >> sz;
-    m = MPI(sz);
+    is >> s;
+    m = MPI(s.c_str());
     return is;
 }
 
@@ -1018,14 +1514,20 @@ bool MPI::IsValid() const
         return false;
     }
 
-    for(int i=0; i<MAX_ARRAY; ++i)
+    for(int i=0; i<mSize; ++i)
     {
-        if(mArray[i] > MOD_VALUE || mArray[i] < 0)
+        if(mArray[i] & ~(DIGIT)DIGIT_MASK)
         {
             return false;
         }
     }
 
+    // Leading digit must be significant.
+    if(mSize > 0 && mArray[mSize-1] == 0)
+    {
+        return false;
+    }
+
     return true;
 }
 
@@ -1033,7 +1535,7 @@ bool MPI::IsValid() const
 void MPI::Display() const
 {
     cout << "MPI [";
-    for(int i=0; i<MAX_ARRAY; ++i)
+    for(int i=0; i<mSize; ++i)
     {
         cout << mArray[i] << ", ";
     }
@@ -1042,31 +1544,31 @@ void MPI::Display() const
 }
 
 // Most significant digit.
-INT32 MPI::MSDigit() const
+DIGIT MPI::MSDigit() const
 {
-    for(int i=MAX_ARRAY-1; i>=0; --i)
+    if(mSize == 0)
     {
-        if(mArray[i] != 0)
-        {
-            return mArray[i];
-        }
+        return 0;
     }
 
-    return 0;
+    return mArray[mSize-1];
 }
 
-// Count the number of significant digits.
-int MPI::Size() const
+// Count the number of significant bits.
+int MPI::Bits() const
 {
-    for(int i=MAX_ARRAY-1; i>=0; --i)
+    if(mSize == 0)
     {
-        if(mArray[i] != 0)
-        {
-            return i+1;
-        }
+        return 0;
     }
 
-    return 0;
+    return (mSize-1) * SHIFT_VALUE + DigitBits(mArray[mSize-1]);
+}
+
+// Count the number of significant digits.
+int MPI::Size() const
+{
+    return mSize;
 }
 
 // Return the largest size of two arguments.
@@ -1090,16 +1592,57 @@ inline int MPI::Largest(const MPI& m) const
     return s + 1;
 }
 
+// Make room for at least n digits, keeping the current value.
+// Storage grows geometrically so repeated growth is cheap.
+void MPI::Reserve(int n)
+{
+    if(n <= mAlloc)
+    {
+        return;
+    }
+
+    int k = mAlloc * 2;
+    if(k < n)
+    {
+        k = n;
+    }
+    if(k < MIN_ARRAY)
+    {
+        k = MIN_ARRAY;
+    }
+
+    DIGIT* p = new DIGIT[k];
+    CountHeapAlloc();
+    for(int i=0; i<mSize; ++i)
+    {
+        p[i] = mArray[i];
+    }
+
+    delete[] mArray;
+    mArray = p;
+    mAlloc = k;
+}
+
+// Drop leading zero digits so that Size() is exact.
+void MPI::Normalize()
+{
+    while(mSize > 0 && mArray[mSize-1] == 0)
+    {
+        --mSize;
+    }
+}
+
 // Shift by n digit positions.
 void MPI::ShiftLeft(const int n)
 {
-    if(n >= MAX_ARRAY-1)
+    if(mSize == 0 || n <= 0)
     {
-        mIsOverflow = true;
         return;
     }
 
-    for(int i=MAX_ARRAY-1; i>n-1; --i)
+    Reserve(mSize+n);
+
+    for(int i=mSize+n-1; i>n-1; --i)
     {
         mArray[i] = mArray[i-n];
     }
@@ -1108,53 +1651,72 @@ void MPI::ShiftLeft(const int n)
     {
         mArray[i] = 0;
     }
+
+    mSize += n;
 }
 
 // Shift by n digit positions.
 void MPI::ShiftRight(const int n)
 {
-    if(n >= MAX_ARRAY-1)
+    if(n <= 0)
     {
-        mIsOverflow = true;
         return;
     }
 
-    for(int i=n; i<MAX_ARRAY; ++i)
+    if(n >= mSize)
     {
-        mArray[i-n] = mArray[i];
+        mSize = 0;
+        return;
     }
 
-    for(int i=MAX_ARRAY-n; i<MAX_ARRAY; ++i)
+    for(int i=n; i<mSize; ++i)
     {
-        mArray[i] = 0;
+        mArray[i-n] = mArray[i];
     }
+
+    mSize -= n;
 }
 
 // Simple multiply using bit shift.
 void MPI::Mult2()
 {
-    INT32 carry = 0;
-
-    for(int i=0; i<MAX_ARRAY; ++i)
-    {
-        mArray[i] <<= 1;
-        if(carry) mArray[i] |= 1;
-
-        carry = mArray[i] & MOD_VALUE;
-        mArray[i] &= MOD_VALUE-1;
-    }
+    ShiftLeftBits(1);
 }
 
 // Simple divide using bit shift.
 void MPI::Div2()
 {
-    INT32 carry = 0;
+    ShiftRightBits(1);
+}
 
-    for(int i=MAX_ARRAY-1; i>=0; --i)
+// Multiply by 2^n using shifts.
+void MPI::ShiftLeftBits(const int n)
+{
+    if(mSize == 0 || n <= 0)
     {
-        if(carry) mArray[i] |= MOD_VALUE;
+        return;
+    }
+
+    // Whole digits, then the bits within a digit.
+    ShiftLeft(n / SHIFT_VALUE);
 
-        carry = mArray[i] & 1;
-        mArray[i] >>= 1;
+    Reserve(mSize+1);
+    mArray[mSize] = DigitsShl(mArray, mArray, mSize, n % SHIFT_VALUE);
+    ++mSize;
+    Normalize();
+}
+
+// Divide by 2^n using shifts.
+void MPI::ShiftRightBits(const int n)
+{
+    if(n <= 0)
+    {
+        return;
     }
+
+    // Whole digits, then the bits within a digit.
+    ShiftRight(n / SHIFT_VALUE);
+
+    DigitsShr(mArray, mArray, mSize, n % SHIFT_VALUE);
+    Normalize();
 }
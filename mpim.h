@@ -13,8 +13,8 @@ conversions, which are useful for initialization, as well as for human
 readable display of results.
 
 The class can be configured at compile time to set the size of the native
-machine register and the maximum size of the supported MPI type. There is
-a trade-off between the supported size and the speed of calculations.
+machine register. Digit storage is allocated from the heap and grows as
+needed, so the size of an MPI is bounded only by available memory.
 
 
 This program is free software: you can redistribute it and/or modify it
@@ -40,72 +40,200 @@ using namespace std;
 
 // Constants.
 #define BASE 10              // Output display base.
-#define MPI_BUFF 5000        // Number of chars in decimal representation.
-#define INT32 long           // Internal digit storage.
-#define INT64 long long      // Intermediate results of digit math.
-#define MOD_VALUE 0x40000000 // Largest value stored in a single digit.
-#define SHIFT_VALUE 30       // How many bits in MOD_VALUE.
-//#define MOD_VALUE 0x100    // Largest value stored in a single digit.
-//#define SHIFT_VALUE 8      // How many bits in MOD_VALUE.
+#define MPI_BUFF 5000        // Chars for up to 4999 decimal places, see StringSize.
 
-// Number of digits in internal representation.
-#define MAX_ARRAY 500 // 15000 bits.
+// Digit size.
+// When the compiler has a 128-bit integer type, digits are full 64-bit
+// machine words and the hardware carry does the digit overflow work.
+// Define MPIM_DIGIT30 to build with the portable 30-bit digits instead.
+#if defined(__SIZEOF_INT128__) && !defined(MPIM_DIGIT30)
+#define MPIM_DIGIT64
+#define DIGIT unsigned long long  // Internal digit storage.
+#define DDIGIT unsigned __int128  // Intermediate results of digit math.
+#define SHIFT_VALUE 64            // How many bits in a digit.
+#define DIGIT_MASK 0xFFFFFFFFFFFFFFFFULL // Largest value stored in a digit.
+#define SDDIGIT __int128          // Signed intermediate results.
+#else
+#define DIGIT unsigned long       // Internal digit storage.
+#define DDIGIT unsigned long long // Intermediate results of digit math.
+#define MOD_VALUE 0x40000000UL    // One more than the largest digit.
+#define SHIFT_VALUE 30            // How many bits in MOD_VALUE.
+//#define MOD_VALUE 0x100UL       // One more than the largest digit.
+//#define SHIFT_VALUE 8           // How many bits in MOD_VALUE.
+#define DIGIT_MASK (MOD_VALUE-1)  // Largest value stored in a digit.
+#define SDDIGIT long long         // Signed intermediate results.
+#endif
+
+// Minimum number of digits allocated for a non-zero MPI.
+#define MIN_ARRAY 4
+
+class MPI;
+class MPIModulus;
+
+// A single digit divisor, with the reciprocal that lets DigitsDivRem1
+// divide by it without a hardware divide. For a constant divisor it is
+// made at compile time, eg.
+//   constexpr MPIDivisor THOUSAND(1000);
+//   x /= THOUSAND;
+struct MPIDivisor
+{
+    DIGIT mDivisor;  // the divisor shifted until its top bit is set, or 0
+    DIGIT mInverse;  // floor((B^2 - 1) / mDivisor) - B, B the digit base
+    int mShift;      // bits the divisor was shifted
+
+    constexpr MPIDivisor() : mDivisor(0), mInverse(0), mShift(0)
+    {
+    }
+
+    constexpr explicit MPIDivisor(DIGIT n) : mDivisor(0), mInverse(0), mShift(0)
+    {
+        n &= DIGIT_MASK;
+        if(n != 0)
+        {
+            while(((n << mShift) & ((DIGIT)1 << (SHIFT_VALUE-1))) == 0)
+            {
+                ++mShift;
+            }
+
+            mDivisor = (n << mShift) & DIGIT_MASK;
+            mInverse = (DIGIT)((((DDIGIT)(~mDivisor & DIGIT_MASK) << SHIFT_VALUE) |
+                                DIGIT_MASK) / mDivisor);
+        }
+    }
+};
+
+/******************************************************************************
+Expression templates.
+
+Adding or subtracting two MPI values does not compute the result right away.
+It returns an MPISum, which records the terms, and further + and - extend
+it. Multiplying the sum by an int gives an MPIScaled, which records the
+multiplier as well. The whole expression is evaluated in a single pass over
+the digits when it is assigned to, added to, or converted to an MPI, so
+  x = (a + b + c) * 4;
+  d += r - p - q;
+need no temporaries and write only the final result. Any other operation
+on an expression converts it to an MPI first.
+
+Expressions hold pointers to their terms. They are meant to be used within
+the statement that builds them, and must not be stored, eg. with auto.
+******************************************************************************/
+
+// One term of an expression: a value with a digit multiplier and a sign.
+struct MPITerm
+{
+    const MPI* mValue;
+    DIGIT mMult;
+    bool mIsNeg;
+};
+
+// Base of all expressions, gives the MPI conversions one signature.
+template<class E>
+class MPIExpr
+{
+public:
+    const E& Self() const
+    {
+        return static_cast<const E&>(*this);
+    }
+};
+
+// Sum and difference of N terms.
+template<int N>
+class MPISum : public MPIExpr< MPISum<N> >
+{
+public:
+    enum { TERMS = N };
+    MPITerm mTerm[N];
+};
+
+// Sum of N terms, multiplied by an int. It cannot be scaled again.
+template<int N>
+class MPIScaled : public MPIExpr< MPIScaled<N> >
+{
+public:
+    enum { TERMS = N };
+    MPITerm mTerm[N];
+};
 
 class MPI
 {
 public:  // Data.
-    INT32 mArray[MAX_ARRAY];
+    DIGIT* mArray;    // Digits, least significant first.
+    int mSize;        // Number of significant digits in use.
+    int mAlloc;       // Number of digits allocated in mArray.
     bool mIsOverflow;
 
 public: // Functions.
 
     // Constructors/ Assignments.
     MPI();
-    void Zero();  // Set to zero.
-    MPI(char*);   // Construct from a decimal string.
-    MPI(int);     // Construct from an integer.
+    MPI(const MPI&);     // Copy constructor.
+    MPI(MPI&&);          // Move constructor, takes the digit storage.
+    ~MPI();
+    void Zero();         // Set to zero.
+    MPI(const char*);    // Construct from a decimal string.
+    MPI(int);            // Construct from an integer.
+
+    MPI& operator=(const MPI&);
+    MPI& operator=(MPI&&);
+    MPI& operator=(int);
+    MPI& operator=(const char*);
 
-    MPI operator=(const MPI&);
-    MPI operator=(int);
-    MPI operator=(char*);
+    // Expression evaluation, see MPISum.
+    template<class E> MPI(const MPIExpr<E>&);
+    template<class E> MPI& operator=(const MPIExpr<E>&);
+    template<class E> MPI& operator+=(const MPIExpr<E>&);
+    template<class E> MPI& operator-=(const MPIExpr<E>&);
+    void Evaluate(const MPITerm*, int);   // Set to a sum of terms.
 
     // Arithmetic, eg.  x = y + z.
-    MPI operator+(const MPI&) const;
+    MPISum<2> operator+(const MPI&) const; // Evaluated later, see MPISum.
     MPI operator+(int) const;
-    MPI operator-(const MPI&) const;
+    MPISum<2> operator-(const MPI&) const; // Evaluated later, see MPISum.
     MPI operator-(int) const;
     MPI operator*(const MPI&) const;
     MPI operator*(int) const;
     MPI operator/(const MPI&) const;
     MPI operator/(int) const;
+    MPI operator/(const MPIDivisor&) const;
     MPI operator%(const MPI&) const;
     MPI operator%(int) const;
+    MPI operator%(const MPIDivisor&) const;
+    MPI operator%(const MPIModulus&) const;
     MPI operator^(const MPI&) const;
     MPI operator^(int) const;
 
-    MPI operator++();
+    MPI& operator++();
     MPI operator++(int);
-    MPI operator--();
+    MPI& operator--();
     MPI operator--(int);
 
     // Shortcut Forms, eg. x += y.
-    MPI operator+=(const MPI&);
-    MPI operator+=(int);
-    MPI operator-=(const MPI&);
-    MPI operator-=(int);
-    MPI operator*=(const MPI&);
-    MPI operator*=(int);
-    MPI operator/=(const MPI&);
-    MPI operator/=(int);
-    MPI operator%=(const MPI&);
-    MPI operator%=(int);
-    MPI operator^=(const MPI&);
-    MPI operator^=(int);
+    // These update the value in place and return a reference to it.
+    MPI& operator+=(const MPI&);
+    MPI& operator+=(int);
+    MPI& operator-=(const MPI&);
+    MPI& operator-=(int);
+    MPI& operator*=(const MPI&);
+    MPI& operator*=(int);
+    MPI& operator/=(const MPI&);
+    MPI& operator/=(int);
+    MPI& operator/=(const MPIDivisor&);
+    MPI& operator%=(const MPI&);
+    MPI& operator%=(int);
+    MPI& operator%=(const MPIDivisor&);
+    MPI& operator%=(const MPIModulus&);
+    MPI& operator^=(const MPI&);
+    MPI& operator^=(int);
 
     // Multiplication: Simple method.
     MPI MultSmpl(const MPI& y) const;
 
-    // Multiplication: Divide and Conquer.
+    // Square, forming each cross product once; x * x does the same.
+    MPI Square() const;
+
+    // Multiplication: Divide and Conquer (Karatsuba).
     MPI MultDC(const MPI&) const;
 
     // Multiplication: A La Russe.
@@ -113,12 +241,37 @@ public: // Functions.
 
     // Special Divide: Return quotient and remainder.
     MPI Divide(const MPI&, MPI&) const;
+    MPI Divide(const MPIDivisor&, DIGIT&) const;  // In one pass.
+    void DivMod(const MPI&, MPI* q, MPI* r) const; // Either may be null.
+
+    // Exact Divide: the divisor must divide this with no remainder.
+    MPI DivExact(const MPI&) const;
 
     // Modulus Functions.
     MPI ModMult(const MPI&, const MPI&) const;
+    MPI ModMult(const MPI&, const MPIModulus&) const;
     MPI ModPow(const MPI&, const MPI&) const;
+    MPI ModPow(const MPI&, const MPIModulus&) const;
+    MPI MontPow(const MPI&, const MPIModulus&) const; // Odd modulus.
+    static void ModPowBatch(MPI* w, const MPI* x, const MPI* y, int n,
+                            const MPIModulus&);  // Threaded, see mpim.cpp.
+    MPI ModPowCRT(const MPI&, const MPI& p, const MPI& q, // Modulo p q,
+                  bool isParallel = true) const;          // p, q prime.
+    MPI ModInverse(const MPI&) const;     // Overflow if there is none.
+    static void ModInverseBatch(MPI* w, const MPI* x, int n,
+                                const MPIModulus&);  // Threaded, see mpimgcd.cpp.
+
+    // Greatest Common Divisor, see mpimgcd.h.
+    MPI GCD(const MPI&) const;
+    MPI ExtGCD(const MPI&, MPI& u, MPI& v) const; // g = u x - v y.
+
+    // Primes, see mpimprime.h.
+    bool IsProbablePrime(int rounds = 25) const; // Miller-Rabin rounds.
+    MPI NextPrime(int rounds = 25) const;        // Smallest above this.
+    static MPI RandomPrime(int bits, int rounds = 25); // Threaded.
 
     // Comparison/ Logical, eg. if(x < y).
+    int Compare(const MPI&) const;  // Three-way compare: -1, 0 or 1.
     bool operator<(const MPI&) const;
     bool operator>(const MPI&) const;
     bool operator<=(const MPI&) const;
@@ -128,7 +281,8 @@ public: // Functions.
 
     // Conversions and I/O.
     int Integer() const;          // Convert to integer.
-    char* String(char []) const;  // Convert to decimal char buffer.
+    char* String(char []) const;  // Convert to decimal char buffer,
+    int StringSize() const;       // of at least this many chars.
     friend ostream& operator<<(ostream&, MPI&);
     friend istream& operator>>(istream&, MPI&);
 
@@ -139,11 +293,233 @@ public: // Functions.
     inline void ShiftRight(const int);    // Shift internal digits n positions.
     inline void Mult2();                  // Quick multiply (using shift) by 2.
     inline void Div2();                   // Quick divide (using shift) by 2.
+    void ShiftLeftBits(const int);        // Multiply by 2^n.
+    void ShiftRightBits(const int);       // Divide by 2^n.
 
-    INT32 MSDigit() const;                // Most significant digit.
+    DIGIT MSDigit() const;                // Most significant digit.
     int Size() const;                     // Count number of significant digits.
+    int Bits() const;                     // Count number of significant bits.
     inline int Largest(const MPI&) const; // Return Size() of largest.
 
+    // Storage management.
+    void Reserve(int);                    // Allocate room for n digits.
+    void Normalize();                     // Drop leading zero digits.
+    DIGIT Digit(int i) const              // Digit i, zero beyond Size().
+    {
+        return (i < mSize) ? mArray[i] : 0;
+    }
+    int Bit(int i) const                  // Bit i, zero beyond Bits().
+    {
+        return (int)(Digit(i / SHIFT_VALUE) >> (i % SHIFT_VALUE)) & 1;
+    }
+
+};
+
+// A modulus prepared for repeated reduction, with the Barrett reciprocal
+// that lets Reduce work with two products and no division. Made once and
+// used for every reduction by the same modulus, eg.
+//   MPIModulus n(m);
+//   w = x.ModMult(y, n);
+// It is not changed by use, so threads may share it.
+//
+// An odd modulus also gets a Montgomery domain, where x stands for
+// x B^n mod m. Products there are reduced by adding a multiple of m that
+// clears the low n digits, again with no division; ModPow works in it.
+class MPIModulus
+{
+public:  // Data.
+    MPI mModulus;     // the modulus m, of n digits
+    MPI mReciprocal;  // floor(B^(2n) / m), B the digit base
+    MPI mInverse;     // -1/m mod B^n, or zero if m is even
+    MPI mR2;          // B^(2n) mod m, or zero if m is even
+
+public: // Functions.
+    explicit MPIModulus(const MPI&);
+
+    const MPI& Value() const
+    {
+        return mModulus;
+    }
+
+    bool IsOdd() const
+    {
+        return mModulus.Digit(0) & 1;
+    }
+
+    void Reduce(MPI&) const;  // x = x mod m, in place.
+
+    // Montgomery domain, odd moduli only. Values must be reduced.
+    MPI ToMont(const MPI&) const;             // x B^n mod m
+    MPI FromMont(const MPI&) const;           // x / B^n mod m
+    MPI MontMult(const MPI&, const MPI&) const; // x y / B^n mod m
 };
+
+/*****************************************************************************/
+// EXPRESSION TEMPLATES
+/*****************************************************************************/
+
+// Construct from an expression.
+template<class E>
+MPI::MPI(const MPIExpr<E>& e)
+{
+    mArray = 0;
+    mSize = 0;
+    mAlloc = 0;
+    mIsOverflow = false;
+
+    Evaluate(e.Self().mTerm, E::TERMS);
+}
+
+// Assign an expression, reusing the digit storage.
+template<class E>
+MPI& MPI::operator=(const MPIExpr<E>& e)
+{
+    Evaluate(e.Self().mTerm, E::TERMS);
+    return *this;
+}
+
+// Add an expression in place, in the same pass.
+template<class E>
+MPI& MPI::operator+=(const MPIExpr<E>& e)
+{
+    MPITerm t[E::TERMS+1] = {{this, 1, false}};
+
+    for(int i=0; i<E::TERMS; ++i)
+    {
+        t[i+1] = e.Self().mTerm[i];
+    }
+
+    Evaluate(t, E::TERMS+1);
+    return *this;
+}
+
+// Subtract an expression in place, in the same pass.
+template<class E>
+MPI& MPI::operator-=(const MPIExpr<E>& e)
+{
+    MPITerm t[E::TERMS+1] = {{this, 1, false}};
+
+    for(int i=0; i<E::TERMS; ++i)
+    {
+        t[i+1] = e.Self().mTerm[i];
+        t[i+1].mIsNeg = !t[i+1].mIsNeg;
+    }
+
+    Evaluate(t, E::TERMS+1);
+    return *this;
+}
+
+// Extend a sum, eg. (a + b) + c.
+template<int N>
+MPISum<N+1> operator+(const MPISum<N>& e, const MPI& m)
+{
+    MPISum<N+1> w;
+
+    for(int i=0; i<N; ++i)
+    {
+        w.mTerm[i] = e.mTerm[i];
+    }
+    w.mTerm[N].mValue = &m;
+    w.mTerm[N].mMult = 1;
+    w.mTerm[N].mIsNeg = false;
+
+    return w;
+}
+
+template<int N>
+MPISum<N+1> operator-(const MPISum<N>& e, const MPI& m)
+{
+    MPISum<N+1> w = e + m;
+    w.mTerm[N].mIsNeg = true;
+    return w;
+}
+
+// Extend a sum from the left, eg. a + (b + c).
+template<int N>
+MPISum<N+1> operator+(const MPI& m, const MPISum<N>& e)
+{
+    return e + m;
+}
+
+template<int N>
+MPISum<N+1> operator-(const MPI& m, const MPISum<N>& e)
+{
+    MPISum<N+1> w = e + m;
+
+    for(int i=0; i<N; ++i)
+    {
+        w.mTerm[i].mIsNeg = !w.mTerm[i].mIsNeg;
+    }
+
+    return w;
+}
+
+// Join two sums, eg. (a + b) - (c + d).
+template<int N, int M>
+MPISum<N+M> operator+(const MPISum<N>& e, const MPISum<M>& f)
+{
+    MPISum<N+M> w;
+
+    for(int i=0; i<N; ++i)
+    {
+        w.mTerm[i] = e.mTerm[i];
+    }
+    for(int i=0; i<M; ++i)
+    {
+        w.mTerm[N+i] = f.mTerm[i];
+    }
+
+    return w;
+}
+
+template<int N, int M>
+MPISum<N+M> operator-(const MPISum<N>& e, const MPISum<M>& f)
+{
+    MPISum<N+M> w = e + f;
+
+    for(int i=N; i<N+M; ++i)
+    {
+        w.mTerm[i].mIsNeg = !w.mTerm[i].mIsNeg;
+    }
+
+    return w;
+}
+
+// Scale a sum, eg. (a + b) * 4.
+template<int N>
+MPIScaled<N> operator*(const MPISum<N>& e, int n)
+{
+    MPIScaled<N> w;
+
+    for(int i=0; i<N; ++i)
+    {
+        w.mTerm[i] = e.mTerm[i];
+        w.mTerm[i].mMult = (DIGIT)n & DIGIT_MASK;
+    }
+
+    return w;
+}
+
+// Everything else evaluates the expression first.
+template<class E> MPI operator+(const MPIExpr<E>& e, const MPI& m) { return MPI(e) + m; }
+template<class E> MPI operator+(const MPIExpr<E>& e, int n)        { return MPI(e) + n; }
+template<class E> MPI operator-(const MPIExpr<E>& e, const MPI& m) { return MPI(e) - m; }
+template<class E> MPI operator-(const MPIExpr<E>& e, int n)        { return MPI(e) - n; }
+template<class E> MPI operator*(const MPIExpr<E>& e, const MPI& m) { return MPI(e) * m; }
+template<class E> MPI operator*(const MPIExpr<E>& e, int n)        { return MPI(e) * n; }
+template<class E> MPI operator/(const MPIExpr<E>& e, const MPI& m) { return MPI(e) / m; }
+template<class E> MPI operator/(const MPIExpr<E>& e, int n)        { return MPI(e) / n; }
+template<class E> MPI operator%(const MPIExpr<E>& e, const MPI& m) { return MPI(e) % m; }
+template<class E> MPI operator%(const MPIExpr<E>& e, int n)        { return MPI(e) % n; }
+template<class E> MPI operator^(const MPIExpr<E>& e, const MPI& m) { return MPI(e) ^ m; }
+template<class E> MPI operator^(const MPIExpr<E>& e, int n)        { return MPI(e) ^ n; }
+
+template<class E> bool operator<(const MPIExpr<E>& e, const MPI& m)  { return MPI(e) < m; }
+template<class E> bool operator>(const MPIExpr<E>& e, const MPI& m)  { return MPI(e) > m; }
+template<class E> bool operator<=(const MPIExpr<E>& e, const MPI& m) { return MPI(e) <= m; }
+template<class E> bool operator>=(const MPIExpr<E>& e, const MPI& m) { return MPI(e) >= m; }
+template<class E> bool operator==(const MPIExpr<E>& e, const MPI& m) { return MPI(e) == m; }
+template<class E> bool operator!=(const MPIExpr<E>& e, const MPI& m) { return MPI(e) != m; }
+
 #endif
 
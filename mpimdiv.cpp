@@ -0,0 +1,506 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpimdiv.h"
+#include "mpimkern.h"
+#include "mpimmul.h"
+#include "mpimscr.h"
+
+static DIGIT DivBlock(DIGIT* q, DIGIT* w, const DIGIT* v, int nv, int k);
+
+/*****************************************************************************/
+// RECURSIVE DIVISION
+/*****************************************************************************/
+
+// The blocks below divide a window w of nv+k digits by v, for 1 <= k <= nv.
+// They write k quotient digits to q and return the quotient digit above
+// them, 0 or 1, as the top nv digits of w may be as large as v. The
+// remainder is left in the low nv digits of w, and the rest zeroed.
+
+// Block by algorithm D.
+static DIGIT DivSchool(DIGIT* q, DIGIT* w, const DIGIT* v, int nv, int k)
+{
+    DIGIT qh = (DigitsCmp(w+k, v, nv) >= 0);
+    if(qh)
+    {
+        DigitsSub(w+k, w+k, nv, v, nv);
+    }
+
+    DigitsDivRem(q, w, nv+k, v, nv);
+    return qh;
+}
+
+// Block by recursion, for k >= 2. A block of nv digits is done as two
+// blocks of half that. A shorter block divides the top 2k digits of w by
+// the top k digits of v, then takes the product of the quotient and the
+// rest of v from w; the quotient is then at most two too large.
+// Algorithm based on Burnikel, C. and Ziegler, J., Fast Recursive
+// Division, 1998.
+static DIGIT DivSplit(DIGIT* q, DIGIT* w, const DIGIT* v, int nv, int k)
+{
+    if(k == nv)
+    {
+        int l = nv/2;  // low quotient digits
+        DIGIT qh = DivBlock(q+l, w+l, v, nv, nv-l);
+        DivBlock(q, w, v, nv, l);
+        return qh;
+    }
+
+    ScratchMark mark;
+    int l = nv-k;      // digits of v left out of the trial division
+
+    DIGIT qh = DivBlock(q, w+l, v+l, k, k);
+
+    DIGIT* t = ScratchAlloc(nv);
+    DigitsMulN(t, q, k, v, l);
+    DIGIT borrow = DigitsSub(w, w, nv, t, nv);
+    if(qh)
+    {
+        borrow += DigitsSub(w+k, w+k, l, v, l);
+    }
+
+    // Add back while the remainder is negative.
+    while(borrow)
+    {
+        qh -= DigitsSub1(q, q, k, 1);
+        borrow -= DigitsAdd(w, w, nv, v, nv);
+    }
+
+    return qh;
+}
+
+// Block, method chosen by size.
+static DIGIT DivBlock(DIGIT* q, DIGIT* w, const DIGIT* v, int nv, int k)
+{
+    if(k < gThresholds.mDivBZ || k < 2)
+    {
+        return DivSchool(q, w, v, nv, k);
+    }
+
+    return DivSplit(q, w, v, nv, k);
+}
+
+// The top block takes the odd part of the quotient; the rest are nv digits
+// each.
+void DigitsDivBZ(DIGIT* q, DIGIT* u, int nu, const DIGIT* v, int nv)
+{
+    int j = nu-nv;  // quotient digits still to find
+
+    while(j > 0)
+    {
+        int k = (j % nv != 0) ? j % nv : nv;
+        j -= k;
+
+        if(k < 2)
+        {
+            DivSchool(q+j, u+j, v, nv, k);
+        }
+        else
+        {
+            DivSplit(q+j, u+j, v, nv, k);
+        }
+    }
+}
+
+/*****************************************************************************/
+// DIVISION BY RECIPROCAL
+/*****************************************************************************/
+
+static void InvertApprox(DIGIT* x, const DIGIT* v, int n);
+
+// Reciprocal by division of B^(2n) - 1 - v B^n, whose top half is below v,
+// adding the B^n back to the quotient. Exact.
+static void InvertDiv(DIGIT* x, const DIGIT* v, int n)
+{
+    ScratchMark mark;
+    DIGIT* u = ScratchAlloc(2*n);
+    for(int i=0; i<n; ++i)
+    {
+        u[i] = DIGIT_MASK;
+        u[n+i] = ~v[i] & DIGIT_MASK;
+    }
+
+    DigitsDivN(x, u, 2*n, v, n);
+    x[n] = 1;
+}
+
+// Reciprocal by one step of Newton's iteration, x' = x + x(1 - vx), from
+// the reciprocal xh of the top h digits of v, for n >= 4. The error of x'
+// is about the square of the relative error of xh; with a digit more than
+// half of v in xh that is below one unit, so the result is within a few
+// units of floor((B^(2n) - 1) / v), either way, whatever the depth.
+static void InvertStep(DIGIT* x, const DIGIT* v, int n)
+{
+    ScratchMark mark;
+    int h = n/2+1;  // digits of v in the first reciprocal
+    int l = n-h;
+
+    DIGIT* xh = ScratchAlloc(h+1);
+    InvertApprox(xh, v+l, h);
+
+    // e = B^(n+h) - v xh, a few times B^n at most, either way.
+    DIGIT* e = ScratchAlloc(n+h+1);
+    DigitsMulN(e, v, n, xh, h+1);
+    bool isNeg = (e[n+h] != 0);
+    if(!isNeg)
+    {
+        for(int i=0; i<n+h; ++i)
+        {
+            e[i] = ~e[i] & DIGIT_MASK;
+        }
+        DigitsAdd1(e, e, n+h, 1);
+    }
+
+    int ne = n+h;
+    while(ne > 0 && e[ne-1] == 0)
+    {
+        --ne;
+    }
+
+    // x = xh B^l, corrected by xh e / B^(2h). The low h-1 digits of e
+    // change that by less than one.
+    for(int i=0; i<l; ++i)
+    {
+        x[i] = 0;
+    }
+    for(int i=0; i<=h; ++i)
+    {
+        x[l+i] = xh[i];
+    }
+
+    int s = h-1;
+    if(ne > h)
+    {
+        DIGIT* p = ScratchAlloc(h+1+ne-s);
+        DigitsMulN(p, xh, h+1, e+s, ne-s);
+
+        if(isNeg)
+        {
+            DigitsSub(x, x, n+1, p+2*h-s, ne+1-h);
+        }
+        else
+        {
+            DigitsAdd(x, x, n+1, p+2*h-s, ne+1-h);
+        }
+    }
+}
+
+// Reciprocal within a few units, method chosen by size.
+static void InvertApprox(DIGIT* x, const DIGIT* v, int n)
+{
+    if(n < gThresholds.mDivNewton || n < 4)
+    {
+        InvertDiv(x, v, n);
+    }
+    else
+    {
+        InvertStep(x, v, n);
+    }
+}
+
+void DigitsInvert(DIGIT* x, const DIGIT* v, int n)
+{
+    if(n < gThresholds.mDivNewton || n < 4)
+    {
+        InvertDiv(x, v, n);
+        return;
+    }
+
+    InvertStep(x, v, n);
+
+    // Make it exact: r = v x must not pass B^(2n) - 1, and B^(2n) - 1 - r
+    // must be less than v.
+    ScratchMark mark;
+    DIGIT* r = ScratchAlloc(2*n+1);
+    DigitsMulN(r, v, n, x, n+1);
+    while(r[2*n] != 0)
+    {
+        DigitsSub1(x, x, n+1, 1);
+        r[2*n] -= DigitsSub(r, r, 2*n, v, n);
+    }
+
+    for(int i=0; i<2*n; ++i)
+    {
+        r[i] = ~r[i] & DIGIT_MASK;
+    }
+
+    for(;;)
+    {
+        int nr = 2*n;
+        while(nr > n && r[nr-1] == 0)
+        {
+            --nr;
+        }
+        if(nr == n && DigitsCmp(r, v, n) < 0)
+        {
+            break;
+        }
+
+        DigitsAdd1(x, x, n+1, 1);
+        DigitsSub(r, r, nr, v, n);
+    }
+}
+
+// Divide the 2n digit window w by v with the n+1 digit reciprocal x. The
+// estimate from the top half of w is within a few units of the quotient,
+// either way, and is corrected against the remainder.
+static void DivInverse(DIGIT* q, DIGIT* w, const DIGIT* v, const DIGIT* x,
+                       int n, DIGIT* t)
+{
+    // q = floor(w1 x / B^n), with w1 the top half of w, and at most
+    // B^n - 1.
+    DigitsMulN(t, w+n, n, x, n+1);
+    for(int i=0; i<n; ++i)
+    {
+        q[i] = (t[2*n] != 0) ? DIGIT_MASK : t[n+i];
+    }
+
+    // Remainder, small enough either way that its low n+1 digits hold it
+    // in two's complement.
+    DigitsMulN(t, q, n, v, n);
+    DigitsSub(w, w, n+1, t, n+1);
+
+    while(w[n] >> (SHIFT_VALUE-1))
+    {
+        DigitsSub1(q, q, n, 1);
+        DigitsAdd(w, w, n+1, v, n);
+    }
+
+    while(w[n] != 0 || DigitsCmp(w, v, n) >= 0)
+    {
+        w[n] -= DigitsSub(w, w, n, v, n);
+        DigitsAdd1(q, q, n, 1);
+    }
+
+    for(int i=n; i<2*n; ++i)
+    {
+        w[i] = 0;
+    }
+}
+
+// The top block takes the odd part of the quotient, by recursive division;
+// the rest are nv digits each, by reciprocal.
+// Algorithm based on Brent, R. and Zimmermann, P., Modern Computer
+// Arithmetic, 2010, section 3.4.
+void DigitsDivNewton(DIGIT* q, DIGIT* u, int nu, const DIGIT* v, int nv)
+{
+    ScratchMark mark;
+    int j = nu-nv;  // quotient digits still to find
+
+    DIGIT* x = ScratchAlloc(nv+1);
+    if(nv < 4)
+    {
+        InvertDiv(x, v, nv);
+    }
+    else
+    {
+        InvertStep(x, v, nv);
+    }
+
+    int k = j % nv;
+    if(k != 0)
+    {
+        j -= k;
+        DivBlock(q+j, u+j, v, nv, k);
+    }
+
+    DIGIT* t = ScratchAlloc(2*nv+1);
+    while(j > 0)
+    {
+        j -= nv;
+        DivInverse(q+j, u+j, v, x, nv, t);
+    }
+}
+
+/*****************************************************************************/
+// EXACT DIVISION
+/*****************************************************************************/
+
+// Hensel division of the n digit window u by b, schoolbook. Each quotient
+// digit clears the lowest digit of u; borrows past the window are dropped,
+// as only the quotient modulo B^n is wanted.
+// Algorithm based on Jebelean, T., An Algorithm for Exact Division, 1993.
+static void DivExactSchool(DIGIT* q, DIGIT* u, int n, const DIGIT* b, int nb,
+                           DIGIT inv)
+{
+    for(int i=0; i<n; ++i)
+    {
+        DIGIT d = (u[i] * inv) & DIGIT_MASK;
+        int k = (nb < n-i) ? nb : n-i;
+
+        q[i] = d;
+        DIGIT borrow = DigitsSubMul1(u+i, b, k, d);
+        if(i+k < n)
+        {
+            DigitsSub1(u+i+k, u+i+k, n-i-k, borrow);
+        }
+    }
+}
+
+// Hensel division by halves, for a window no longer than b: the low half
+// of the quotient depends only on the low half of u. Its product with b is
+// then taken from the high half, which leaves the division for the high
+// half of the quotient.
+static void DivExactSplit(DIGIT* q, DIGIT* u, int n, const DIGIT* b, int nb,
+                          DIGIT inv)
+{
+    if(n < gThresholds.mDivExact || n < 2)
+    {
+        DivExactSchool(q, u, n, b, nb, inv);
+        return;
+    }
+
+    ScratchMark mark;
+    int h = n/2;
+
+    DivExactSplit(q, u, h, b, nb, inv);
+
+    DIGIT* t = ScratchAlloc(h+n);
+    DigitsMulN(t, q, h, b, n);
+    DigitsSub(u+h, u+h, n-h, t+h, n-h);
+
+    DivExactSplit(q+h, u+h, n-h, b, nb, inv);
+}
+
+// Hensel division of the n digit window u by b, method chosen by size.
+// A window longer than b is done in blocks of nb quotient digits, each
+// taking its product with b from the rest of the window.
+static void DivExactN(DIGIT* q, DIGIT* u, int n, const DIGIT* b, int nb,
+                      DIGIT inv)
+{
+    if(nb < gThresholds.mDivExact || n < gThresholds.mDivExact)
+    {
+        DivExactSchool(q, u, n, b, nb, inv);
+        return;
+    }
+
+    ScratchMark mark;
+    DIGIT* t = ScratchAlloc(2*nb);
+
+    for(int j=0; j<n; j+=nb)
+    {
+        int m = (nb < n-j) ? nb : n-j;  // quotient digits in this block
+        DivExactSplit(q+j, u+j, m, b, nb, inv);
+
+        int k = (nb < n-j-m) ? nb : n-j-m;  // window digits above it
+        if(k > 0)
+        {
+            DigitsMulN(t, q+j, m, b, nb);
+            DIGIT borrow = DigitsSub(u+j+m, u+j+m, k, t+m, k);
+            if(j+m+k < n)
+            {
+                DigitsSub1(u+j+m+k, u+j+m+k, n-j-m-k, borrow);
+            }
+        }
+    }
+}
+
+// The top part of the quotient, down to and including digit h-1, by
+// ordinary division of the top digits of a by the top t+1 digits of b,
+// for t quotient digits. Truncating b leaves the result within one or two
+// units either way, which the caller corrects from digit h-1.
+static void DivExactTop(DIGIT* q, const DIGIT* a, int na, const DIGIT* b,
+                        int nb, int h)
+{
+    ScratchMark mark;
+    int t = na-nb+2-h;                  // quotient digits wanted
+    int s = (nb > t+1) ? nb-t-1 : 0;    // low digits of b left out
+    int nv = nb-s;
+    int nu = na-s-h+1;
+
+    int d = SHIFT_VALUE - DigitBits(b[nb-1]);
+    DIGIT* u = ScratchAlloc(nu+1);
+    DIGIT* v = ScratchAlloc(nv);
+    u[nu] = DigitsShl(u, a+s+h-1, nu, d);
+    DigitsShl(v, b+s, nv, d);
+
+    DigitsDivN(q, u, nu+1, v, nv);
+}
+
+// Large quotients are found from both ends, after Krandick, W. and
+// Jebelean, T., Bidirectional Exact Integer Division, 1996: the low half by
+// Hensel division and the high half by ordinary division of the top
+// digits, each about a quarter of the work of the whole. They overlap in
+// one digit, which tells how far the high half is out.
+void DigitsDivExact(DIGIT* q, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    ScratchMark mark;
+    int n = na-nb+1;  // quotient digits
+
+    // Newton's iteration, each step doubles the correct low bits; any odd
+    // b is its own inverse to 3 bits.
+    DIGIT inv = b[0];
+    for(int i=0; i<5; ++i)
+    {
+        inv = (inv * (2 - b[0] * inv)) & DIGIT_MASK;
+    }
+
+    int h = (n >= gThresholds.mDivExact && n >= 4) ? n/2 : n;  // low digits
+
+    DIGIT* u = ScratchAlloc(h);
+    for(int i=0; i<h; ++i)
+    {
+        u[i] = a[i];
+    }
+
+    DivExactN(q, u, h, b, nb, inv);
+    if(h == n)
+    {
+        return;
+    }
+
+    DIGIT* t = ScratchAlloc(n-h+1);
+    DivExactTop(t, a, na, b, nb, h);
+
+    // Digit h-1 is known, so the difference there is the error.
+    DIGIT e = (t[0] - q[h-1]) & DIGIT_MASK;
+    if(e >> (SHIFT_VALUE-1))
+    {
+        DigitsAdd1(t, t, n-h+1, (0 - e) & DIGIT_MASK);
+    }
+    else
+    {
+        DigitsSub1(t, t, n-h+1, e);
+    }
+
+    for(int i=h; i<n; ++i)
+    {
+        q[i] = t[i-h+1];
+    }
+}
+
+/*****************************************************************************/
+// DISPATCH
+/*****************************************************************************/
+
+void DigitsDivN(DIGIT* q, DIGIT* u, int nu, const DIGIT* v, int nv)
+{
+    if(nv < gThresholds.mDivBZ || nu-nv < gThresholds.mDivBZ || nv < 2)
+    {
+        DigitsDivRem(q, u, nu, v, nv);
+    }
+    else if(nv >= gThresholds.mDivNewton && nv >= 4 && nu-nv >= nv)
+    {
+        DigitsDivNewton(q, u, nu, v, nv);
+    }
+    else
+    {
+        DigitsDivBZ(q, u, nu, v, nv);
+    }
+}
@@ -0,0 +1,67 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+Division of digit vectors. DigitsDivN picks a method by size: Knuth's
+algorithm D below the recursive division threshold, then Burnikel and
+Ziegler's recursive division, which turns a division into two of half the
+size and two half size products, so it gains from every multiplication
+method in mpimmul.h. For the largest divisors the reciprocal of the
+divisor is found once by Newton's iteration, and each block of quotient
+digits then costs two products.
+
+A division known to be exact goes the other way, from the low digits up,
+see DigitsDivExact. Each quotient digit then comes from one product with
+the inverse of the low divisor digit, with no trial and no correction.
+Large quotients are found from both ends at once.
+
+The divisor must be normalized, with the top bit of its top digit set;
+DivSpans in mpim.cpp shifts both operands first. The thresholds are in
+gThresholds, see mpimmul.h.
+
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpim.h"
+
+#ifndef MPIMDIV_H
+#define MPIMDIV_H
+
+// Division of u by v, method chosen by size. Same contract as DigitsDivRem
+// in mpimkern.h: v is normalized with nv digits, u has nu >= nv digits and
+// its top nv digits are less than v. Writes nu-nv quotient digits to q,
+// leaves the remainder in the low nv digits of u and zeros the rest.
+// q must not overlap u or v.
+void DigitsDivN(DIGIT* q, DIGIT* u, int nu, const DIGIT* v, int nv);
+
+// As DigitsDivN, by recursive division, with the smaller divisions done
+// by size.
+void DigitsDivBZ(DIGIT* q, DIGIT* u, int nu, const DIGIT* v, int nv);
+
+// As DigitsDivN, by multiplying with the reciprocal of v, which takes one
+// step of Newton's iteration from the reciprocal of the top half.
+void DigitsDivNewton(DIGIT* q, DIGIT* u, int nu, const DIGIT* v, int nv);
+
+// q = a / b, where b is odd and divides a exactly, by Hensel division from
+// the low digits up. Needs na >= nb >= 1; writes na-nb+1 digits. Only the
+// low na-nb+1 digits of a are read. q must not overlap a or b.
+void DigitsDivExact(DIGIT* q, const DIGIT* a, int na, const DIGIT* b, int nb);
+
+// x = floor((B^(2n) - 1) / v), for a normalized v of n digits.
+// Writes n+1 digits; the top one is always 1. x must not overlap v.
+void DigitsInvert(DIGIT* x, const DIGIT* v, int n);
+
+#endif
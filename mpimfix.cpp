@@ -0,0 +1,60 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpimfix.h"
+
+/*****************************************************************************/
+// COMPILE TIME CHECKS
+/*****************************************************************************/
+
+// FixedMPI is all templates, so nothing else instantiates it. These are
+// evaluated as constant expressions, for whichever digit size is built.
+
+typedef FixedMPI<256> Fixed256;
+typedef FixedMPI<512> Fixed512;
+
+constexpr unsigned long long MAX64 = ~0ULL;
+constexpr Fixed256 X(MAX64);
+constexpr Fixed256 X4 = X * X * X * X;  // (2^64-1)^4 < 2^256
+constexpr Fixed256 X5 = X4 * X;
+
+static_assert(!X.mIsOverflow, "2^64-1 fits");
+static_assert(!X4.mIsOverflow, "(2^64-1)^4 fits in 256 bits");
+static_assert(X5.mIsOverflow, "(2^64-1)^5 does not fit in 256 bits");
+
+// Add and subtract, with wrapping below zero and above the top.
+constexpr Fixed256 MAX256 = Fixed256() - Fixed256(1);
+static_assert(Fixed256(5) - Fixed256(3) == Fixed256(2), "5 - 3");
+static_assert(!(Fixed256(5) - Fixed256(3)).mIsOverflow, "5 - 3 fits");
+static_assert(Fixed256(2) + Fixed256(3) == Fixed256(5), "2 + 3");
+static_assert(MAX256.mIsOverflow, "0 - 1 wraps");
+static_assert(MAX256 > X4 && X4 > X, "2^256-1 > (2^64-1)^4 > 2^64-1");
+static_assert(Fixed256(MAX64) + Fixed256(1) - Fixed256(1) == X, "x + 1 - 1");
+static_assert(MAX256 + Fixed256(1) == Fixed256(), "2^256 wraps to 0");
+static_assert((Fixed256(MAX64 - 1) + Fixed256(1)).Compare(X) == 0, "carry");
+
+// The wide product matches the same product done at twice the width.
+constexpr Fixed512 Y(MAX64);
+static_assert(X4.MulWide(X4) == Y * Y * Y * Y * Y * Y * Y * Y, "(2^64-1)^8");
+static_assert(!X4.MulWide(X4).mIsOverflow, "wide product fits");
+constexpr Fixed512 Z(1ULL << 32);
+constexpr Fixed512 P256 = Z * Z * Z * Z * Z * Z * Z * Z;
+static_assert(!MAX256.MulWide(MAX256).mIsOverflow, "wide product of 2^256-1 fits");
+static_assert(MAX256.MulWide(MAX256) + Fixed512(2) * P256 == Fixed512(1),
+              "(2^256-1)^2 + 2 2^256 wraps to 1");
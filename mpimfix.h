@@ -0,0 +1,280 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+Fixed width multi-precision integers.
+
+FixedMPI<Bits> holds an unsigned integer of exactly Bits bits in a digit
+array on the stack. There is no heap storage and no size tracking, and
+all loops run over a length known at compile time, so the compiler can
+unroll them completely. Arithmetic wraps modulo 2^Bits and sets the
+overflow flag when a result did not fit, in the same way MPI flags a
+negative subtraction.
+
+The kernels are constexpr, so constants can be computed at compile time.
+Conversions to and from MPI are provided for the operations which have no
+fixed width version, such as division.
+
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include <cstddef>
+#include "mpim.h"
+
+#ifndef MPIMFIX_H
+#define MPIMFIX_H
+
+template<size_t Bits>
+class FixedMPI
+{
+public:  // Constants.
+    enum
+    {
+        DIGITS = (Bits + SHIFT_VALUE - 1) / SHIFT_VALUE, // Digits of storage.
+        TOP_BITS = Bits - (DIGITS - 1) * SHIFT_VALUE     // Bits used in top digit.
+    };
+
+public:  // Data.
+    DIGIT mArray[DIGITS]; // Digits, least significant first.
+    bool mIsOverflow;
+
+public: // Functions.
+
+    // Constructors/ Assignments.
+    constexpr FixedMPI() : mArray(), mIsOverflow(false)
+    {
+    }
+
+    // Construct from a native integer.
+    constexpr FixedMPI(unsigned long long n) : mArray(), mIsOverflow(false)
+    {
+        for(int i=0; i<DIGITS && n != 0; ++i)
+        {
+            mArray[i] = (DIGIT)(n & DIGIT_MASK);
+            n = (SHIFT_VALUE < 64) ? (n >> (SHIFT_VALUE % 64)) : 0;
+        }
+
+        mIsOverflow = (n != 0) || Trim();
+    }
+
+    // Construct from an MPI, keeping the low Bits bits.
+    explicit FixedMPI(const MPI& m) : mArray(), mIsOverflow(m.mIsOverflow)
+    {
+        int n = (m.mSize < DIGITS) ? m.mSize : DIGITS;
+        for(int i=0; i<n; ++i)
+        {
+            mArray[i] = m.mArray[i];
+        }
+
+        mIsOverflow |= (m.mSize > DIGITS) || Trim();
+    }
+
+    // Construct from a decimal string.
+    explicit FixedMPI(const char* psz) : FixedMPI(MPI(psz))
+    {
+    }
+
+    // Convert to a general MPI.
+    operator MPI() const
+    {
+        MPI w;
+
+        w.Reserve(DIGITS);
+        for(int i=0; i<DIGITS; ++i)
+        {
+            w.mArray[i] = mArray[i];
+        }
+
+        w.mSize = DIGITS;
+        w.Normalize();
+        w.mIsOverflow = mIsOverflow;
+
+        return w;
+    }
+
+    // Arithmetic, eg.  x = y + z.
+    constexpr FixedMPI operator+(const FixedMPI& m) const
+    {
+        FixedMPI w(*this);
+        w += m;
+        return w;
+    }
+
+    constexpr FixedMPI operator-(const FixedMPI& m) const
+    {
+        FixedMPI w(*this);
+        w -= m;
+        return w;
+    }
+
+    constexpr FixedMPI operator*(const FixedMPI& m) const
+    {
+        FixedMPI w;
+
+        // Row by row, dropping digits past the top.
+        // Algorithm based on Menezes, 14.12, p. 595.
+#pragma GCC unroll 16
+        for(int i=0; i<DIGITS; ++i)
+        {
+            DIGIT carry = 0;
+
+            if(m.mArray[i] == 0)
+            {
+                continue;
+            }
+
+#pragma GCC unroll 16
+            for(int j=0; j<DIGITS-i; ++j)
+            {
+                DDIGIT uv = (DDIGIT)mArray[j] * m.mArray[i] + w.mArray[i+j] + carry;
+                w.mArray[i+j] = (DIGIT)(uv & DIGIT_MASK);   // LOWORD
+                carry = (DIGIT)(uv >> SHIFT_VALUE);         // HIWORD
+            }
+
+            // Anything carried or left over above the top is lost.
+            w.mIsOverflow |= (carry != 0);
+            for(int j=DIGITS-i; j<DIGITS; ++j)
+            {
+                w.mIsOverflow |= (mArray[j] != 0);
+            }
+        }
+
+        w.mIsOverflow |= w.Trim();
+        return w;
+    }
+
+    // Full product, twice as wide, which never overflows.
+    constexpr FixedMPI<2*Bits> MulWide(const FixedMPI& m) const
+    {
+        FixedMPI<2*Bits> w;
+
+#pragma GCC unroll 16
+        for(int i=0; i<DIGITS; ++i)
+        {
+            DIGIT carry = 0;
+
+#pragma GCC unroll 16
+            for(int j=0; j<DIGITS; ++j)
+            {
+                DDIGIT uv = (DDIGIT)mArray[j] * m.mArray[i] + w.mArray[i+j] + carry;
+                w.mArray[i+j] = (DIGIT)(uv & DIGIT_MASK);   // LOWORD
+                carry = (DIGIT)(uv >> SHIFT_VALUE);         // HIWORD
+            }
+
+            if(i+DIGITS < FixedMPI<2*Bits>::DIGITS)
+            {
+                w.mArray[i+DIGITS] = carry;
+            }
+        }
+
+        return w;
+    }
+
+    // Shortcut Forms, eg. x += y.
+    // Algorithm based on Menezes, 14.7, p. 594.
+    constexpr FixedMPI& operator+=(const FixedMPI& m)
+    {
+        DIGIT carry = 0;
+
+#pragma GCC unroll 64
+        for(int i=0; i<DIGITS; ++i)
+        {
+            DDIGIT s = (DDIGIT)mArray[i] + m.mArray[i] + carry;
+            mArray[i] = (DIGIT)(s & DIGIT_MASK);
+            carry = (DIGIT)(s >> SHIFT_VALUE);
+        }
+
+        mIsOverflow |= (carry != 0) || Trim();
+        return *this;
+    }
+
+    // Algorithm based on Menezes, 14.9, p. 595.
+    constexpr FixedMPI& operator-=(const FixedMPI& m)
+    {
+        DIGIT borrow = 0;
+
+#pragma GCC unroll 64
+        for(int i=0; i<DIGITS; ++i)
+        {
+            DDIGIT s = (DDIGIT)mArray[i] - m.mArray[i] - borrow;
+            mArray[i] = (DIGIT)(s & DIGIT_MASK);
+            borrow = (DIGIT)(s >> SHIFT_VALUE) & 1;
+        }
+
+        // Wrapping below zero leaves bits above the top to clear.
+        Trim();
+        mIsOverflow |= (borrow != 0);
+        return *this;
+    }
+
+    constexpr FixedMPI& operator*=(const FixedMPI& m)
+    {
+        return *this = *this * m;
+    }
+
+    // Comparison/ Logical, eg. if(x < y).
+    constexpr int Compare(const FixedMPI& m) const
+    {
+#pragma GCC unroll 64
+        for(int i=DIGITS-1; i>=0; --i)
+        {
+            if(mArray[i] != m.mArray[i])
+            {
+                return (mArray[i] < m.mArray[i]) ? -1 : 1;
+            }
+        }
+
+        return 0;
+    }
+
+    constexpr bool operator<(const FixedMPI& m) const  { return Compare(m) < 0; }
+    constexpr bool operator>(const FixedMPI& m) const  { return Compare(m) > 0; }
+    constexpr bool operator<=(const FixedMPI& m) const { return Compare(m) <= 0; }
+    constexpr bool operator>=(const FixedMPI& m) const { return Compare(m) >= 0; }
+    constexpr bool operator==(const FixedMPI& m) const { return Compare(m) == 0; }
+    constexpr bool operator!=(const FixedMPI& m) const { return Compare(m) != 0; }
+
+    // Conversions and I/O.
+    char* String(char sz[]) const
+    {
+        return MPI(*this).String(sz);
+    }
+
+    friend ostream& operator<<(ostream& os, const FixedMPI& m)
+    {
+        MPI w(m);
+        return os << w;
+    }
+
+private:
+    // Clear any bits above Bits in the top digit.
+    // Returns true if there were any.
+    constexpr bool Trim()
+    {
+        if(TOP_BITS == SHIFT_VALUE)
+        {
+            return false;
+        }
+
+        DIGIT mask = ((DIGIT)1 << (TOP_BITS % SHIFT_VALUE)) - 1;
+        bool isLost = (mArray[DIGITS-1] & ~mask) != 0;
+        mArray[DIGITS-1] &= mask;
+
+        return isLost;
+    }
+};
+
+#endif
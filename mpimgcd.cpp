@@ -0,0 +1,772 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpimgcd.h"
+#include "mpimkern.h"
+#include "mpimmul.h"
+#include "mpimpool.h"
+#include "mpimscr.h"
+#include <utility>
+
+/*****************************************************************************/
+// BINARY GCD
+/*****************************************************************************/
+
+// Number of zero bits below the lowest one, for a not zero.
+static int LowZeroBits(const DIGIT* a)
+{
+    int i = 0;
+    while(a[i] == 0)
+    {
+        ++i;
+    }
+
+    return i * SHIFT_VALUE + DigitBits(a[i] & ((DIGIT)0 - a[i])) - 1;
+}
+
+// a = a >> bits, in place. Returns the new size.
+static int ShiftDown(DIGIT* a, int na, int bits)
+{
+    int d = bits / SHIFT_VALUE;
+    for(int i=d; i<na; ++i)
+    {
+        a[i-d] = a[i];
+    }
+    na -= d;
+
+    DigitsShr(a, a, na, bits % SHIFT_VALUE);
+    while(na > 0 && a[na-1] == 0)
+    {
+        --na;
+    }
+
+    return na;
+}
+
+// Both are made odd, then the smaller is taken from the larger, which is
+// then even and shifted until odd again, until they are equal. The common
+// factors of two are put back at the end.
+// Algorithm based on Menezes, 14.54, p. 606.
+int DigitsGcdBinary(DIGIT* a, int na, DIGIT* b, int nb)
+{
+    int za = LowZeroBits(a);
+    int zb = LowZeroBits(b);
+    int k = (za < zb) ? za : zb;
+
+    int n = na;  // room in a
+    na = ShiftDown(a, na, za);
+    nb = ShiftDown(b, nb, zb);
+
+    // Single digits in registers.
+    if(na == 1 && nb == 1)
+    {
+        DIGIT x = a[0];
+        DIGIT y = b[0];
+        while(x != y)
+        {
+            if(x > y)
+            {
+                x -= y;
+                x >>= DigitBits(x & ((DIGIT)0 - x)) - 1;
+            }
+            else
+            {
+                y -= x;
+                y >>= DigitBits(y & ((DIGIT)0 - y)) - 1;
+            }
+        }
+        a[0] = x;
+    }
+
+    for(;;)
+    {
+        int c = (na != nb) ? ((na > nb) ? 1 : -1) : DigitsCmp(a, b, na);
+        if(c == 0)
+        {
+            break;
+        }
+
+        if(c > 0)
+        {
+            DigitsSub(a, a, na, b, nb);
+            na = ShiftDown(a, na, LowZeroBits(a));
+        }
+        else
+        {
+            DigitsSub(b, b, nb, a, na);
+            nb = ShiftDown(b, nb, LowZeroBits(b));
+        }
+    }
+
+    // g 2^k is at most the first a, so it fits in its n digits.
+    int d = k / SHIFT_VALUE;
+    for(int i=na-1; i>=0; --i)
+    {
+        a[i+d] = a[i];
+    }
+    for(int i=0; i<d; ++i)
+    {
+        a[i] = 0;
+    }
+    na += d;
+
+    DIGIT c = DigitsShl(a+d, a+d, na-d, k % SHIFT_VALUE);
+    if(c != 0 && na < n)
+    {
+        a[na++] = c;
+    }
+
+    return na;
+}
+
+/*****************************************************************************/
+// LEHMER'S GCD
+/*****************************************************************************/
+
+// Matrices are kept as four entries m00 m01 m10 m11, and a matrix M for
+// (a, b) means (a, b) before = M (a, b) after. A step of Euclid's
+// algorithm that takes q b from a is the matrix ((1 q) (0 1)), and the
+// values after are found with the inverse ((m11 -m01) (-m10 m00)).
+
+// Bits k up of x, at most 2 SHIFT_VALUE of them.
+static DDIGIT TopBits(const MPI& x, int k)
+{
+    int i = k / SHIFT_VALUE;
+    int s = k % SHIFT_VALUE;
+
+    DDIGIT t = (DDIGIT)x.Digit(i) | ((DDIGIT)x.Digit(i+1) << SHIFT_VALUE);
+    if(s > 0)
+    {
+        t = (t >> s) | ((DDIGIT)x.Digit(i+2) << (2*SHIFT_VALUE - s));
+    }
+
+    return t;
+}
+
+// floor(x / y), for x >= y > 0. Most quotients are one, and most of the
+// rest fit a single digit divide.
+static DDIGIT Quotient(DDIGIT x, DDIGIT y)
+{
+    if(x - y < y)
+    {
+        return 1;
+    }
+    if((x >> SHIFT_VALUE) == 0)
+    {
+        return (DIGIT)x / (DIGIT)y;
+    }
+
+    return x / y;
+}
+
+// The longest run of Euclid's quotients for the top two digits of a and
+// b whose matrix s still holds for the full values, with single digit
+// entries. Write a = x 2^k + a0 and b = y 2^k + b0; the reduced values
+// are then x' 2^k + (s11 a0 - s01 b0) and y' 2^k + (s00 b0 - s10 a0),
+// which cannot be negative while x' >= s01 and y' >= s10. Returns false
+// if not even one quotient holds.
+static bool LehmerMatrix(DIGIT* s, const MPI& a, const MPI& b)
+{
+    int n = (a.Bits() > b.Bits()) ? a.Bits() : b.Bits();
+    int k = (n > 2*SHIFT_VALUE) ? n - 2*SHIFT_VALUE : 0;
+
+    DDIGIT x = TopBits(a, k);
+    DDIGIT y = TopBits(b, k);
+    DDIGIT u00 = 1;
+    DDIGIT u01 = 0;
+    DDIGIT u10 = 0;
+    DDIGIT u11 = 1;
+
+    for(;;)
+    {
+        if(x >= y)
+        {
+            if(y == 0) break;
+
+            DDIGIT q = Quotient(x, y);
+            if(q > DIGIT_MASK) break;
+
+            DDIGIT t01 = u01 + q*u00;
+            DDIGIT t11 = u11 + q*u10;
+            DDIGIT r = x - q*y;
+            if(t01 > DIGIT_MASK || t11 > DIGIT_MASK || r < t01) break;
+
+            x = r;
+            u01 = t01;
+            u11 = t11;
+        }
+        else
+        {
+            if(x == 0) break;
+
+            DDIGIT q = Quotient(y, x);
+            if(q > DIGIT_MASK) break;
+
+            DDIGIT t10 = u10 + q*u11;
+            DDIGIT t00 = u00 + q*u01;
+            DDIGIT r = y - q*x;
+            if(t10 > DIGIT_MASK || t00 > DIGIT_MASK || r < t10) break;
+
+            y = r;
+            u10 = t10;
+            u00 = t00;
+        }
+    }
+
+    s[0] = (DIGIT)u00;
+    s[1] = (DIGIT)u01;
+    s[2] = (DIGIT)u10;
+    s[3] = (DIGIT)u11;
+
+    return u01 != 0 || u10 != 0;
+}
+
+// (a, b) = (a s11 - b s01, b s00 - a s10), the values after the matrix s
+// of single digits, in one pass over the digits. Both are known not to
+// be negative. ta and tb are work space, and are left with the values
+// before.
+static void ApplyMatrix1(MPI& a, MPI& b, const DIGIT* s, MPI& ta, MPI& tb)
+{
+    int n = (a.mSize > b.mSize) ? a.mSize : b.mSize;
+    ta.Reserve(n+1);
+    tb.Reserve(n+1);
+
+    DIGIT* x = ta.mArray;
+    DIGIT* y = tb.mArray;
+    DIGIT ca = 0;       // carries of a s11, b s01, b s00, a s10
+    DIGIT cb = 0;
+    DIGIT cc = 0;
+    DIGIT cd = 0;
+    SDDIGIT bx = 0;     // borrows of the two differences
+    SDDIGIT by = 0;
+
+    for(int i=0; i<n; ++i)
+    {
+        DIGIT ai = a.Digit(i);
+        DIGIT bi = b.Digit(i);
+
+        DDIGIT p = (DDIGIT)ai * s[3] + ca;
+        DDIGIT q = (DDIGIT)bi * s[1] + cb;
+        ca = (DIGIT)(p >> SHIFT_VALUE);
+        cb = (DIGIT)(q >> SHIFT_VALUE);
+        SDDIGIT t = (SDDIGIT)(p & DIGIT_MASK) - (SDDIGIT)(q & DIGIT_MASK) + bx;
+        x[i] = (DIGIT)((DDIGIT)t & DIGIT_MASK);
+        bx = t >> SHIFT_VALUE;
+
+        p = (DDIGIT)bi * s[0] + cc;
+        q = (DDIGIT)ai * s[2] + cd;
+        cc = (DIGIT)(p >> SHIFT_VALUE);
+        cd = (DIGIT)(q >> SHIFT_VALUE);
+        t = (SDDIGIT)(p & DIGIT_MASK) - (SDDIGIT)(q & DIGIT_MASK) + by;
+        y[i] = (DIGIT)((DDIGIT)t & DIGIT_MASK);
+        by = t >> SHIFT_VALUE;
+    }
+
+    x[n] = (DIGIT)((DDIGIT)((SDDIGIT)ca - cb + bx) & DIGIT_MASK);
+    y[n] = (DIGIT)((DDIGIT)((SDDIGIT)cc - cd + by) & DIGIT_MASK);
+
+    ta.mSize = n+1;
+    tb.mSize = n+1;
+    ta.Normalize();
+    tb.Normalize();
+    std::swap(a, ta);
+    std::swap(b, tb);
+}
+
+// w = x c + y d, for single digits c and d. w must not be x or y.
+static void MulAdd(MPI& w, const MPI& x, DIGIT c, const MPI& y, DIGIT d)
+{
+    int n = (x.mSize > y.mSize) ? x.mSize : y.mSize;
+    w.Reserve(n+2);
+
+    DIGIT* p = w.mArray;
+    p[x.mSize] = DigitsMul1(p, x.mArray, x.mSize, c);
+    for(int i=x.mSize+1; i<=n+1; ++i)
+    {
+        p[i] = 0;
+    }
+
+    DIGIT carry = DigitsAddMul1(p, y.mArray, y.mSize, d);
+    DigitsAdd1(p+y.mSize, p+y.mSize, n+2-y.mSize, carry);
+
+    w.mSize = n+2;
+    w.Normalize();
+}
+
+// t = m s, for a matrix s of single digits.
+static void MatMul1(MPI* t, const MPI* m, const DIGIT* s)
+{
+    MulAdd(t[0], m[0], s[0], m[1], s[2]);
+    MulAdd(t[1], m[0], s[1], m[1], s[3]);
+    MulAdd(t[2], m[2], s[0], m[3], s[2]);
+    MulAdd(t[3], m[2], s[1], m[3], s[3]);
+}
+
+// t = m s.
+static void MatMul(MPI* t, const MPI* m, const MPI* s)
+{
+    t[0] = m[0]*s[0] + m[1]*s[2];
+    t[1] = m[0]*s[1] + m[1]*s[3];
+    t[2] = m[2]*s[0] + m[3]*s[2];
+    t[3] = m[2]*s[1] + m[3]*s[3];
+}
+
+// One step of Euclid's algorithm, on whichever of a and b is larger. If r
+// is given it is the second row of a matrix for (a, b), and is updated.
+static void DivStep(MPI& a, MPI& b, MPI* r)
+{
+    MPI q;
+    MPI rem;
+
+    if(a >= b)
+    {
+        a.DivMod(b, &q, &rem);
+        std::swap(a, rem);
+        if(r != 0)
+        {
+            r[1] += q * r[0];
+        }
+    }
+    else
+    {
+        b.DivMod(a, &q, &rem);
+        std::swap(b, rem);
+        if(r != 0)
+        {
+            r[0] += q * r[1];
+        }
+    }
+}
+
+/*****************************************************************************/
+// HALF GCD
+/*****************************************************************************/
+
+// The reductions below keep a >= m01 and b >= m10, for the matrix m of
+// all the steps so far. Then m holds for any pair of values whose top
+// bits are the a and b it started from, as for LehmerMatrix.
+
+// One step of Euclid's algorithm, taken only if the bound still holds.
+// Returns false if it was not taken.
+static bool StepChecked(MPI& a, MPI& b, MPI* m)
+{
+    MPI q;
+    MPI rem;
+
+    if(a >= b)
+    {
+        if(b.mSize == 0) return false;
+
+        a.DivMod(b, &q, &rem);
+        MPI t01 = m[1] + q * m[0];
+        if(rem < t01) return false;
+
+        std::swap(a, rem);
+        std::swap(m[1], t01);
+        m[3] += q * m[2];
+    }
+    else
+    {
+        if(a.mSize == 0) return false;
+
+        b.DivMod(a, &q, &rem);
+        MPI t10 = m[2] + q * m[3];
+        if(rem < t10) return false;
+
+        std::swap(b, rem);
+        std::swap(m[2], t10);
+        m[0] += q * m[1];
+    }
+
+    return true;
+}
+
+// As HalfGcd, by Lehmer steps until the bound fails.
+static void HalfGcdLehmer(MPI& a, MPI& b, MPI* m)
+{
+    MPI ta;
+    MPI tb;
+    MPI t[4];
+    DIGIT s[4];
+
+    while(a.mSize > 0 && b.mSize > 0)
+    {
+        if(!LehmerMatrix(s, a, b))
+        {
+            if(!StepChecked(a, b, m)) break;
+            continue;
+        }
+
+        // The values before are left in ta and tb.
+        ApplyMatrix1(a, b, s, ta, tb);
+        MatMul1(t, m, s);
+        if(a < t[1] || b < t[2])
+        {
+            std::swap(a, ta);
+            std::swap(b, tb);
+
+            // The last few quotients may still hold one at a time.
+            while(StepChecked(a, b, m))
+            {
+            }
+            break;
+        }
+
+        for(int i=0; i<4; ++i)
+        {
+            std::swap(m[i], t[i]);
+        }
+    }
+}
+
+static void HalfGcd(MPI& a, MPI& b, MPI* m);
+
+// x B^k + p - q, known not to be negative.
+static MPI Join(const MPI& x, int k, const MPI& p, const MPI& q)
+{
+    MPI w;
+
+    int n = x.mSize + k;
+    if(n < p.mSize) n = p.mSize;
+    if(n < q.mSize) n = q.mSize;
+    ++n;
+
+    w.Reserve(n);
+    for(int i=0; i<n; ++i)
+    {
+        w.mArray[i] = (i >= k && i < k+x.mSize) ? x.mArray[i-k] : 0;
+    }
+
+    DigitsAdd(w.mArray, w.mArray, n, p.mArray, p.mSize);
+    DigitsSub(w.mArray, w.mArray, n, q.mArray, q.mSize);
+
+    w.mSize = n;
+    w.Normalize();
+    return w;
+}
+
+// Reduces a and b by the matrix s that HalfGcd finds for their digits from
+// k up, and sets m = m s, if the bound still holds for the product.
+// The top digits of the reduced values are those HalfGcd leaves, so only
+// the low k digits are multiplied by s. Returns false if nothing changed.
+static bool ReduceTop(MPI& a, MPI& b, MPI* m, int k)
+{
+    MPI x;
+    MPI y;
+    MPI a0;
+    MPI b0;
+
+    x = a;
+    y = b;
+    x.ShiftRightBits(k * SHIFT_VALUE);
+    y.ShiftRightBits(k * SHIFT_VALUE);
+    a0.Reserve(k);
+    b0.Reserve(k);
+    for(int i=0; i<k; ++i)
+    {
+        a0.mArray[i] = a.Digit(i);
+        b0.mArray[i] = b.Digit(i);
+    }
+    a0.mSize = k;
+    b0.mSize = k;
+    a0.Normalize();
+    b0.Normalize();
+
+    MPI s[4];
+    HalfGcd(x, y, s);
+    if(s[1].mSize == 0 && s[2].mSize == 0)
+    {
+        return false;
+    }
+
+    MPI ra = Join(x, k, s[3] * a0, s[1] * b0);
+    MPI rb = Join(y, k, s[0] * b0, s[2] * a0);
+    MPI t[4];
+    MatMul(t, m, s);
+    if(ra < t[1] || rb < t[2])
+    {
+        return false;
+    }
+
+    std::swap(a, ra);
+    std::swap(b, rb);
+    for(int i=0; i<4; ++i)
+    {
+        std::swap(m[i], t[i]);
+    }
+
+    return true;
+}
+
+// Reduces a and b of n digits to about n/2 digits, and sets m to the
+// matrix for all the steps taken. The top half of the values gives a
+// matrix that takes them to about 3n/4 digits, and the top of what is
+// left gives one that takes them the rest of the way, each found by
+// this function on half the digits. The second part is sized so that
+// the bound is expected to hold for the product; if it does not, only
+// the first part is kept.
+// Algorithm based on Moller, "On Schonhage's algorithm and subquadratic
+// integer gcd computation", Math. Comp. 77 (2008).
+static void HalfGcd(MPI& a, MPI& b, MPI* m)
+{
+    m[0] = 1;
+    m[1] = 0;
+    m[2] = 0;
+    m[3] = 1;
+
+    int n = (a.mSize > b.mSize) ? a.mSize : b.mSize;
+    if(n < gThresholds.mGcdHalf || n < 4)
+    {
+        HalfGcdLehmer(a, b, m);
+        return;
+    }
+
+    ReduceTop(a, b, m, n/2);
+
+    // A quotient too large for the top digits to show.
+    StepChecked(a, b, m);
+
+    // At most half the digits, in case the first part did little.
+    int n2 = (a.mSize > b.mSize) ? a.mSize : b.mSize;
+    int s = 2*n2-n-1;
+    if(s > n/2)
+    {
+        s = n/2;
+    }
+    if(s > 2)
+    {
+        ReduceTop(a, b, m, n2-s);
+    }
+}
+
+/*****************************************************************************/
+// GCD FUNCTIONS
+/*****************************************************************************/
+
+// Reduces a and b until one is zero, leaving the gcd in the other. If r
+// is given it is the second row of a matrix for (a, b), and is updated;
+// otherwise small values finish by the binary method.
+static void GcdReduce(MPI& a, MPI& b, MPI* r)
+{
+    MPI ta;
+    MPI tb;
+    MPI t0;
+    MPI t1;
+    DIGIT s[4];
+
+    while(a.mSize > 0 && b.mSize > 0)
+    {
+        int n = (a.mSize > b.mSize) ? a.mSize : b.mSize;
+        int d = (a.mSize > b.mSize) ? a.mSize-b.mSize : b.mSize-a.mSize;
+
+        if(r == 0 && n < gThresholds.mGcdLehmer)
+        {
+            ScratchMark mark;
+            DIGIT* x = ScratchAlloc(a.mSize);
+            DIGIT* y = ScratchAlloc(b.mSize);
+            for(int i=0; i<a.mSize; ++i)
+            {
+                x[i] = a.mArray[i];
+            }
+            for(int i=0; i<b.mSize; ++i)
+            {
+                y[i] = b.mArray[i];
+            }
+
+            a.mSize = DigitsGcdBinary(x, a.mSize, y, b.mSize);
+            for(int i=0; i<a.mSize; ++i)
+            {
+                a.mArray[i] = x[i];
+            }
+            b.Zero();
+            return;
+        }
+
+        // Values of different lengths take a division step first.
+        if(d <= 1 && n >= gThresholds.mGcdHalf)
+        {
+            MPI m[4];
+            HalfGcd(a, b, m);
+            if(m[1].mSize != 0 || m[2].mSize != 0)
+            {
+                if(r != 0)
+                {
+                    t0 = r[0]*m[0] + r[1]*m[2];
+                    t1 = r[0]*m[1] + r[1]*m[3];
+                    std::swap(r[0], t0);
+                    std::swap(r[1], t1);
+                }
+                continue;
+            }
+        }
+        else if(d <= 1 && LehmerMatrix(s, a, b))
+        {
+            ApplyMatrix1(a, b, s, ta, tb);
+            if(r != 0)
+            {
+                MulAdd(t0, r[0], s[0], r[1], s[2]);
+                MulAdd(t1, r[0], s[1], r[1], s[3]);
+                std::swap(r[0], t0);
+                std::swap(r[1], t1);
+            }
+            continue;
+        }
+
+        DivStep(a, b, r);
+    }
+}
+
+// Returns gcd(x, y) = g, and sets u to the cofactor of x, from 1 to y/g,
+// with u x = g mod y. If y is zero, g = x and u = 1; if x is zero, g = y
+// and u = 0.
+static MPI GcdCofactor(const MPI& x, const MPI& y, MPI& u)
+{
+    if(y.mSize == 0)
+    {
+        u = 1;
+        return x;
+    }
+    if(x.mSize == 0)
+    {
+        u = 0;
+        return y;
+    }
+
+    // With (x, y) = M (a, b), g = m11 x - m01 y if b ends at zero, and
+    // g = m00 y - m10 x if a does.
+    MPI a = x;
+    MPI b = y;
+    MPI r[2];
+    r[0] = 0;
+    r[1] = 1;
+    GcdReduce(a, b, r);
+
+    if(b.mSize == 0)
+    {
+        MPI yg = y.DivExact(a);
+        u = (r[1] - 1) % yg + 1;
+        return a;
+    }
+
+    MPI yg = y.DivExact(b);
+    u = yg - r[0] % yg;
+    return b;
+}
+
+// Greatest Common Divisor, by size, see mpimgcd.h. gcd(x, 0) = x.
+MPI MPI::GCD(const MPI& y) const
+{
+    MPI a = *this;
+    MPI b = y;
+
+    GcdReduce(a, b, 0);
+
+    return (a.mSize > 0) ? a : b;
+}
+
+// Extended Greatest Common Divisor: returns g = gcd(x, y) and sets u and
+// v with g = u x - v y, where 1 <= u <= y/g and 0 <= v < x/g. If y is
+// zero, u = 1 and v = 0; if x is zero, both are zero. Either of u and v
+// may be x or y, so they are written last.
+MPI MPI::ExtGCD(const MPI& y, MPI& u, MPI& v) const
+{
+    MPI s;
+    MPI g = GcdCofactor(*this, y, s);
+
+    MPI t = 0;
+    if(mSize != 0 && y.mSize != 0)
+    {
+        t = s * *this - g;
+        t = t.DivExact(y);
+    }
+
+    u = s;
+    v = t;
+    return g;
+}
+
+// Modular Inverse: w with x w = 1 mod m, from 0 to m-1. If there is
+// none, because m is zero or shares a factor with x, the result is zero
+// with the overflow flag set.
+MPI MPI::ModInverse(const MPI& m) const
+{
+    MPI w;  // return value
+
+    if(m.mSize == 0)
+    {
+        w.mIsOverflow = true;
+        return w;
+    }
+
+    MPI x = *this % m;
+    MPI g = GcdCofactor(x, m, w);
+    if(g != 1)
+    {
+        w.Zero();
+        w.mIsOverflow = true;
+        return w;
+    }
+
+    // w = m only for m = 1.
+    return w % m;
+}
+
+// Modular Inverses w[i] of x[i] modulo m for i < n, by Montgomery's
+// trick: the running products x[0] x[1] ... x[i] are formed, the last is
+// inverted, and each inverse is then peeled off with two products on the
+// way back, which is 3(n-1) products and one inverse. On the thread pool
+// each thread takes a range, with one inverse of its own. An x[i] with no
+// inverse leaves its range to be done one at a time, which marks it with
+// the overflow flag as ModInverse does. w must not be x.
+void MPI::ModInverseBatch(MPI* w, const MPI* x, int n, const MPIModulus& m)
+{
+    int threads = GetThreadCount();
+    int grain = (n + threads - 1) / threads;
+    if(grain < 1)
+    {
+        grain = 1;
+    }
+
+    ParallelFor(0, n, grain, [=, &m](int lo, int hi)
+    {
+        w[lo] = x[lo];
+        m.Reduce(w[lo]);
+        for(int i=lo+1; i<hi; ++i)
+        {
+            w[i] = w[i-1].ModMult(x[i], m);
+        }
+
+        MPI v = w[hi-1].ModInverse(m.Value());
+        if(v.mIsOverflow)
+        {
+            for(int i=lo; i<hi; ++i)
+            {
+                w[i] = x[i].ModInverse(m.Value());
+            }
+            return;
+        }
+
+        for(int i=hi-1; i>lo; --i)
+        {
+            w[i] = v.ModMult(w[i-1], m);
+            v = v.ModMult(x[i], m);
+        }
+        w[lo] = v;
+    });
+}
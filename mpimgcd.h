@@ -0,0 +1,46 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+Greatest common divisors, see MPI::GCD, MPI::ExtGCD and MPI::ModInverse.
+The method is picked by size. A few digits use Stein's binary method,
+which needs only subtraction and shifts. Larger values use Lehmer's
+method: the top two digits of both values are enough to find a run of
+Euclid's quotients, collected in a matrix of single digits, which is then
+applied to the full values in one pass. The largest use the half gcd
+recursion, which finds the matrix for the top half of the values from
+the top quarter, and so on down, so that the matrices are multiplied by
+the fast methods in mpimmul.h.
+
+Every matrix has determinant one and no negative entries, so only
+unsigned values are needed. A matrix found from the top bits of two
+values is used for the full values only while each reduced value is at
+least as large as an entry that bounds the error from the lower bits;
+then neither can go negative.
+
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpim.h"
+
+#ifndef MPIMGCD_H
+#define MPIMGCD_H
+
+// gcd(a, b) by the binary method, for a, b not zero. Both are overwritten;
+// the gcd is left in a, and its size returned.
+int DigitsGcdBinary(DIGIT* a, int na, DIGIT* b, int nb);
+
+#endif
@@ -0,0 +1,550 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpimkern.h"
+#include "mpimsimd.h"
+
+/*****************************************************************************/
+// ADDITION AND SUBTRACTION
+/*****************************************************************************/
+
+// Add digit vectors.
+// Algorithm based on Menezes, 14.7, p. 594.
+static DIGIT DigitsAddPortable(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    DIGIT carry = 0;
+    int i;
+
+    // Add the overlapping digits.
+    for(i=0; i<nb; ++i)
+    {
+        DDIGIT s = (DDIGIT)a[i] + b[i] + carry;
+        w[i] = (DIGIT)(s & DIGIT_MASK);
+        carry = (DIGIT)(s >> SHIFT_VALUE);
+    }
+
+    // Propagate the carry through the longer argument.
+    return DigitsAdd1(w+i, a+i, na-i, carry);
+}
+
+// Add a single digit to a digit vector.
+DIGIT DigitsAdd1(DIGIT* w, const DIGIT* a, int na, DIGIT n)
+{
+    DIGIT carry = n;
+    int i;
+
+    for(i=0; i<na && carry; ++i)
+    {
+        DDIGIT s = (DDIGIT)a[i] + carry;
+        w[i] = (DIGIT)(s & DIGIT_MASK);
+        carry = (DIGIT)(s >> SHIFT_VALUE);
+    }
+
+    // Carry died, the rest is a copy.
+    if(w != a)
+    {
+        for(; i<na; ++i)
+        {
+            w[i] = a[i];
+        }
+    }
+
+    return carry;
+}
+
+// Subtract digit vectors.
+// Algorithm based on Menezes, 14.9, p. 595.
+static DIGIT DigitsSubPortable(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    DIGIT borrow = 0;
+    int i;
+
+    // Subtract the overlapping digits.
+    for(i=0; i<nb; ++i)
+    {
+        DDIGIT s = (DDIGIT)a[i] - b[i] - borrow;
+        w[i] = (DIGIT)(s & DIGIT_MASK);
+        borrow = (DIGIT)(s >> SHIFT_VALUE) & 1;
+    }
+
+    // Propagate the borrow through the longer argument.
+    return DigitsSub1(w+i, a+i, na-i, borrow);
+}
+
+// Subtract a single digit from a digit vector.
+DIGIT DigitsSub1(DIGIT* w, const DIGIT* a, int na, DIGIT n)
+{
+    DIGIT borrow = n;
+    int i;
+
+    for(i=0; i<na && borrow; ++i)
+    {
+        DDIGIT s = (DDIGIT)a[i] - borrow;
+        w[i] = (DIGIT)(s & DIGIT_MASK);
+        borrow = (DIGIT)(s >> SHIFT_VALUE) & 1;
+    }
+
+    // Borrow died, the rest is a copy.
+    if(w != a)
+    {
+        for(; i<na; ++i)
+        {
+            w[i] = a[i];
+        }
+    }
+
+    return borrow;
+}
+
+/*****************************************************************************/
+// MULTIPLICATION
+/*****************************************************************************/
+
+// Multiply a digit vector by a single digit.
+// Algorithm based on Menezes, 14.12, p. 595.
+DIGIT DigitsMul1(DIGIT* w, const DIGIT* a, int na, DIGIT n)
+{
+    DIGIT carry = 0;
+
+    for(int i=0; i<na; ++i)
+    {
+        DDIGIT uv = (DDIGIT)a[i] * n + carry;
+        w[i] = (DIGIT)(uv & DIGIT_MASK);      // LOWORD
+        carry = (DIGIT)(uv >> SHIFT_VALUE);   // HIWORD
+    }
+
+    return carry;
+}
+
+// Multiply by a single digit and accumulate.
+DIGIT DigitsAddMul1(DIGIT* w, const DIGIT* a, int na, DIGIT n)
+{
+    DIGIT carry = 0;
+
+    for(int i=0; i<na; ++i)
+    {
+        DDIGIT uv = (DDIGIT)a[i] * n + w[i] + carry;
+        w[i] = (DIGIT)(uv & DIGIT_MASK);      // LOWORD
+        carry = (DIGIT)(uv >> SHIFT_VALUE);   // HIWORD
+    }
+
+    return carry;
+}
+
+// Multiply by a single digit and take away.
+DIGIT DigitsSubMul1(DIGIT* w, const DIGIT* a, int na, DIGIT n)
+{
+    DIGIT borrow = 0;
+
+    for(int i=0; i<na; ++i)
+    {
+        DDIGIT uv = (DDIGIT)a[i] * n + borrow;
+        DIGIT lo = (DIGIT)(uv & DIGIT_MASK);
+        borrow = (DIGIT)(uv >> SHIFT_VALUE);
+
+        // Subtract the low word, the high word goes on to the next digit.
+        borrow += (w[i] < lo);
+        w[i] = (w[i] - lo) & DIGIT_MASK;
+    }
+
+    return borrow;
+}
+
+// Multiply digit vectors, one row per digit of b.
+// Algorithm based on Menezes, 14.12, p. 595.
+static void DigitsMulPortable(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    w[na] = DigitsMul1(w, a, na, b[0]);
+
+    for(int i=1; i<nb; ++i)
+    {
+        w[na+i] = DigitsAddMul1(w+i, a, na, b[i]);
+    }
+}
+
+// Square a digit vector. The products a[i]*a[j] with i < j are summed
+// once, doubled, and the squares a[i]*a[i] added on the diagonal.
+// Algorithm based on Menezes, 14.16, p. 597.
+void DigitsSqr(DIGIT* w, const DIGIT* a, int na)
+{
+    // Cross products, one row per digit, each row starting past the
+    // diagonal. Row i ends at digit i+na, which nothing has written yet.
+    w[0] = 0;
+    w[na] = DigitsMul1(w+1, a+1, na-1, a[0]);
+    for(int i=1; i<na-1; ++i)
+    {
+        w[i+na] = DigitsAddMul1(w+2*i+1, a+i+1, na-i-1, a[i]);
+    }
+    w[2*na-1] = 0;
+
+    // Double the cross products while adding the squares.
+    DIGIT top = 0;    // bit shifted out of the digit below
+    DIGIT carry = 0;
+    for(int i=0; i<na; ++i)
+    {
+        DDIGIT sq = (DDIGIT)a[i] * a[i];
+
+        DIGIT d = ((w[2*i] << 1) & DIGIT_MASK) | top;
+        top = w[2*i] >> (SHIFT_VALUE-1);
+        DDIGIT s = (DDIGIT)d + (DIGIT)(sq & DIGIT_MASK) + carry;
+        w[2*i] = (DIGIT)(s & DIGIT_MASK);
+        carry = (DIGIT)(s >> SHIFT_VALUE);
+
+        d = ((w[2*i+1] << 1) & DIGIT_MASK) | top;
+        top = w[2*i+1] >> (SHIFT_VALUE-1);
+        s = (DDIGIT)d + (DIGIT)(sq >> SHIFT_VALUE) + carry;
+        w[2*i+1] = (DIGIT)(s & DIGIT_MASK);
+        carry = (DIGIT)(s >> SHIFT_VALUE);
+    }
+}
+
+/*****************************************************************************/
+// SHIFTING
+/*****************************************************************************/
+
+// Shift a digit vector up by less than one digit, for bits > 0.
+static DIGIT DigitsShlPortable(DIGIT* w, const DIGIT* a, int na, int bits)
+{
+    // Work from the top down so w may overlap a.
+    DIGIT out = a[na-1] >> (SHIFT_VALUE - bits);
+    for(int i=na-1; i>0; --i)
+    {
+        w[i] = ((a[i] << bits) & DIGIT_MASK) | (a[i-1] >> (SHIFT_VALUE - bits));
+    }
+    w[0] = (a[0] << bits) & DIGIT_MASK;
+
+    return out;
+}
+
+// Shift a digit vector down by less than one digit, for bits > 0.
+static DIGIT DigitsShrPortable(DIGIT* w, const DIGIT* a, int na, int bits)
+{
+    // Work from the bottom up so w may overlap a.
+    DIGIT out = (a[0] << (SHIFT_VALUE - bits)) & DIGIT_MASK;
+    for(int i=0; i<na-1; ++i)
+    {
+        w[i] = (a[i] >> bits) | ((a[i+1] << (SHIFT_VALUE - bits)) & DIGIT_MASK);
+    }
+    w[na-1] = a[na-1] >> bits;
+
+    return out;
+}
+
+/*****************************************************************************/
+// DIVISION
+/*****************************************************************************/
+
+// Divide the two digits u1 u0 by a normalized divisor, where u1 is below
+// it, by multiplying with its reciprocal. Returns the quotient and sets r
+// to the remainder.
+// Algorithm based on Moller, N. and Granlund, T., Improved Division by
+// Invariant Integers, 2011, algorithm 4.
+static inline DIGIT DivRem2By1(DIGIT u1, DIGIT u0, const MPIDivisor& d, DIGIT& r)
+{
+    DDIGIT p = (DDIGIT)d.mInverse * u1 + ((((DDIGIT)u1 + 1) << SHIFT_VALUE) | u0);
+    DIGIT q1 = (DIGIT)(p >> SHIFT_VALUE) & DIGIT_MASK;
+    DIGIT q0 = (DIGIT)p & DIGIT_MASK;
+
+    // The estimate is at most one too large, or one too small. Which way
+    // is hard to predict, so the first fix is made without a branch.
+    r = (u0 - q1 * d.mDivisor) & DIGIT_MASK;
+    DIGIT m = (DIGIT)0 - (r > q0);
+    q1 = (q1 + m) & DIGIT_MASK;
+    r = (r + (m & d.mDivisor)) & DIGIT_MASK;
+    if(r >= d.mDivisor)
+    {
+        ++q1;
+        r -= d.mDivisor;
+    }
+
+    return q1;
+}
+
+// Divide a digit vector by a single digit, from the top down.
+DIGIT DigitsDivRem1(DIGIT* q, const DIGIT* a, int na, DIGIT n)
+{
+    return DigitsDivRem1(q, a, na, MPIDivisor(n));
+}
+
+// The dividend is shifted along with the divisor, a digit at a time, so
+// the quotient is unchanged and the remainder comes out shifted.
+DIGIT DigitsDivRem1(DIGIT* q, const DIGIT* a, int na, const MPIDivisor& d)
+{
+    int s = d.mShift;
+    DIGIT r = 0;
+
+    if(na == 0)
+    {
+        return 0;
+    }
+
+    if(s == 0)
+    {
+        for(int i=na-1; i>=0; --i)
+        {
+            q[i] = DivRem2By1(r, a[i], d, r);
+        }
+
+        return r;
+    }
+
+    // Each digit is read before q, which may be a, is written over it.
+    DIGIT hi = a[na-1];
+    r = hi >> (SHIFT_VALUE - s);
+    for(int i=na-1; i>0; --i)
+    {
+        DIGIT lo = a[i-1];
+        DIGIT u0 = ((hi << s) | (lo >> (SHIFT_VALUE - s))) & DIGIT_MASK;
+        q[i] = DivRem2By1(r, u0, d, r);
+        hi = lo;
+    }
+    q[0] = DivRem2By1(r, (hi << s) & DIGIT_MASK, d, r);
+
+    return r >> s;
+}
+
+// Divide exactly by an odd digit, working from the bottom up with the
+// inverse of n modulo the digit base instead of dividing.
+// Algorithm based on Jebelean, An Algorithm for Exact Division, 1993.
+void DigitsDivExact1(DIGIT* q, const DIGIT* a, int na, DIGIT n)
+{
+    // Newton's iteration, each step doubles the correct low bits; any odd
+    // n is its own inverse to 3 bits.
+    DIGIT inv = n;
+    for(int i=0; i<5; ++i)
+    {
+        inv = (inv * (2 - n * inv)) & DIGIT_MASK;
+    }
+
+    DIGIT c = 0;
+    for(int i=0; i<na; ++i)
+    {
+        DIGIT borrow = (a[i] < c);
+        DIGIT s = (a[i] - c) & DIGIT_MASK;
+        DIGIT d = (s * inv) & DIGIT_MASK;
+
+        q[i] = d;
+        c = (DIGIT)(((DDIGIT)d * n) >> SHIFT_VALUE) + borrow;
+    }
+}
+
+// Divide digit vectors, classical.
+// Algorithm based on Knuth, D, p. 257.
+void DigitsDivRem(DIGIT* q, DIGIT* u, int nu, const DIGIT* v, int nv)
+{
+    DIGIT v1 = v[nv-1];                  // top divisor digit
+    DIGIT v2 = (nv > 1) ? v[nv-2] : 0;   // next divisor digit
+    MPIDivisor d(v1);                    // reciprocal of v1
+
+    // Main calculation loop, one quotient digit per window u[j-nv..j].
+    for(int j=nu-1; j>=nv; --j)
+    {
+        DDIGIT qh; // trial quotient
+        DDIGIT rh; // trial remainder
+
+        // Calculate trial quotient from the top two digits.
+        if(u[j] >= v1)
+        {
+            qh = DIGIT_MASK;
+            rh = (((DDIGIT)u[j] << SHIFT_VALUE) | u[j-1]) - qh * v1;
+        }
+        else
+        {
+            DIGIT r;
+            qh = DivRem2By1(u[j], u[j-1], d, r);
+            rh = r;
+        }
+
+        // Adjust quotient if too large, using the next digit.
+        while(nv > 1 && rh <= DIGIT_MASK &&
+              qh * v2 > ((rh << SHIFT_VALUE) | u[j-2]))
+        {
+            --qh;
+            rh += v1;
+        }
+
+        // Multiply and subtract.
+        DIGIT borrow = DigitsSubMul1(u+j-nv, v, nv, (DIGIT)qh);
+
+        // Add back if the window went negative.
+        if(u[j] < borrow)
+        {
+            --qh;
+            DigitsAdd(u+j-nv, u+j-nv, nv, v, nv);
+        }
+        u[j] = 0;
+
+        // Set the quotient digit we just found.
+        q[j-nv] = (DIGIT)qh;
+    }
+}
+
+/*****************************************************************************/
+// COMPARISON AND BITS
+/*****************************************************************************/
+
+// Count significant bits in a digit.
+int DigitBits(DIGIT d)
+{
+    if(d == 0)
+    {
+        return 0;
+    }
+
+    return 64 - __builtin_clzll((unsigned long long)d);
+}
+
+// Compare digit vectors of equal length.
+int DigitsCmp(const DIGIT* a, const DIGIT* b, int n)
+{
+    for(int i=n-1; i>=0; --i)
+    {
+        if(a[i] != b[i])
+        {
+            return (a[i] < b[i]) ? -1 : 1;
+        }
+    }
+
+    return 0;
+}
+
+/*****************************************************************************/
+// DISPATCH
+/*****************************************************************************/
+
+static constexpr MPIKernels gPortable =
+{
+    DigitsAddPortable,
+    DigitsSubPortable,
+    DigitsMulPortable,
+    DigitsShlPortable,
+    DigitsShrPortable
+};
+
+// Kernels in use; the portable ones until SetKernelLevel runs.
+static MPIKernels gKernels = gPortable;
+
+static int gKernelLevel = KERNEL_PORTABLE;
+
+// Widest level the processor supports.
+static int KernelLevelMax()
+{
+#ifdef MPIM_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+    {
+        return KERNEL_AVX512;
+    }
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return KERNEL_AVX2;
+    }
+#endif
+    return KERNEL_PORTABLE;
+}
+
+int SetKernelLevel(int level)
+{
+    int max = KernelLevelMax();
+    if(level > max)
+    {
+        level = max;
+    }
+
+    MPIKernels k = gPortable;
+
+#ifdef MPIM_SIMD
+    if(level >= KERNEL_AVX2)
+    {
+        KernelsAvx2(&k);
+    }
+    if(level >= KERNEL_AVX512)
+    {
+        KernelsAvx512(&k);
+    }
+#endif
+
+    gKernels = k;
+    gKernelLevel = level;
+
+    return level;
+}
+
+int GetKernelLevel()
+{
+    return gKernelLevel;
+}
+
+// Pick the kernels before main.
+static int gKernelInit = SetKernelLevel(KERNEL_AVX512);
+
+DIGIT DigitsAdd(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    return gKernels.mAdd(w, a, na, b, nb);
+}
+
+DIGIT DigitsSub(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    return gKernels.mSub(w, a, na, b, nb);
+}
+
+void DigitsMul(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    gKernels.mMul(w, a, na, b, nb);
+}
+
+DIGIT DigitsShl(DIGIT* w, const DIGIT* a, int na, int bits)
+{
+    if(na == 0)
+    {
+        return 0;
+    }
+
+    if(bits == 0)
+    {
+        for(int i=na-1; i>=0; --i)
+        {
+            w[i] = a[i];
+        }
+
+        return 0;
+    }
+
+    return gKernels.mShl(w, a, na, bits);
+}
+
+DIGIT DigitsShr(DIGIT* w, const DIGIT* a, int na, int bits)
+{
+    if(na == 0)
+    {
+        return 0;
+    }
+
+    if(bits == 0)
+    {
+        for(int i=0; i<na; ++i)
+        {
+            w[i] = a[i];
+        }
+
+        return 0;
+    }
+
+    return gKernels.mShr(w, a, na, bits);
+}
@@ -0,0 +1,115 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+Digit vector kernels. These are the low level loops shared by the MPI
+arithmetic operators. They work on raw arrays of digits, least significant
+digit first, and touch only the digits they are given. Lengths are passed
+explicitly and results are not normalized.
+
+Unless noted otherwise, the result array may be the same as the first
+argument, which allows the operators to update a value in place.
+
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpim.h"
+
+#ifndef MPIMKERN_H
+#define MPIMKERN_H
+
+// w = a + b, where na >= nb. Writes na digits, returns the carry.
+DIGIT DigitsAdd(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb);
+
+// w = a + n for a single digit n. Writes na digits, returns the carry.
+// When w is a, stops as soon as the carry dies.
+DIGIT DigitsAdd1(DIGIT* w, const DIGIT* a, int na, DIGIT n);
+
+// w = a - b, where na >= nb. Writes na digits, returns the borrow.
+DIGIT DigitsSub(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb);
+
+// w = a - n for a single digit n. Writes na digits, returns the borrow.
+// When w is a, stops as soon as the borrow dies.
+DIGIT DigitsSub1(DIGIT* w, const DIGIT* a, int na, DIGIT n);
+
+// w = a * n for a single digit n. Writes na digits, returns the carry.
+DIGIT DigitsMul1(DIGIT* w, const DIGIT* a, int na, DIGIT n);
+
+// w += a * n for a single digit n. Updates na digits, returns the carry.
+DIGIT DigitsAddMul1(DIGIT* w, const DIGIT* a, int na, DIGIT n);
+
+// w -= a * n for a single digit n. Updates na digits, returns the borrow.
+DIGIT DigitsSubMul1(DIGIT* w, const DIGIT* a, int na, DIGIT n);
+
+// w = a * b, schoolbook method. Writes na+nb digits.
+// Needs na, nb >= 1, and w must not overlap a or b.
+void DigitsMul(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb);
+
+// w = a * a, schoolbook method, each cross product formed once.
+// Writes 2*na digits. Needs na >= 1, and w must not overlap a.
+void DigitsSqr(DIGIT* w, const DIGIT* a, int na);
+
+// w = a << bits, for 0 <= bits < SHIFT_VALUE. Writes na digits, returns
+// the bits shifted out of the top. w may be at or above a.
+DIGIT DigitsShl(DIGIT* w, const DIGIT* a, int na, int bits);
+
+// w = a >> bits, for 0 <= bits < SHIFT_VALUE. Writes na digits, returns
+// the bits shifted out of the bottom, at the top of the digit.
+// w may be at or below a.
+DIGIT DigitsShr(DIGIT* w, const DIGIT* a, int na, int bits);
+
+// q = a / n for a single digit n. Writes na digits, returns the remainder.
+DIGIT DigitsDivRem1(DIGIT* q, const DIGIT* a, int na, DIGIT n);
+
+// As above, with the reciprocal of n already made, see MPIDivisor.
+// Needs a divisor other than zero.
+DIGIT DigitsDivRem1(DIGIT* q, const DIGIT* a, int na, const MPIDivisor& d);
+
+// q = a / n for a single odd digit n that divides a exactly. Writes na
+// digits. The result is exact modulo B^na, so a negative a in two's
+// complement gives a negative q.
+void DigitsDivExact1(DIGIT* q, const DIGIT* a, int na, DIGIT n);
+
+// Long division of u by v, Knuth algorithm D.
+// The divisor v has nv digits and must be normalized, with the top bit of
+// v[nv-1] set. The dividend u has nu >= nv digits, and its top nv digits
+// must be less than v. Writes nu-nv quotient digits to q, leaves the
+// remainder in the low nv digits of u and zeros the rest.
+// q must not overlap u or v.
+void DigitsDivRem(DIGIT* q, DIGIT* u, int nu, const DIGIT* v, int nv);
+
+// Number of significant bits in a digit.
+int DigitBits(DIGIT d);
+
+// Compare two n digit vectors from the most significant digit down.
+// Returns -1, 0 or 1.
+int DigitsCmp(const DIGIT* a, const DIGIT* b, int n);
+
+// Instruction sets for the kernels. At startup the widest one the
+// processor supports is chosen; SetKernelLevel can lower it, eg. to
+// compare with the portable code, and returns the level now in use.
+// Change it before starting other threads.
+enum
+{
+    KERNEL_PORTABLE,
+    KERNEL_AVX2,
+    KERNEL_AVX512
+};
+
+int SetKernelLevel(int level);
+int GetKernelLevel();
+
+#endif
@@ -0,0 +1,444 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpimmod.h"
+#include "mpimkern.h"
+#include "mpimmul.h"
+#include "mpimscr.h"
+
+/*****************************************************************************/
+// BARRETT REDUCTION
+/*****************************************************************************/
+
+// The digits of a * b from column g up, without the columns below g-2,
+// which add less than one to column g. Writes na+nb-g digits; the result
+// may be up to one below the true one. Needs g >= 2.
+static void MulHigh(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb,
+                    int g)
+{
+    int k = na+nb-g+2;
+    for(int i=0; i<k; ++i)
+    {
+        w[i] = 0;
+    }
+
+    for(int i=0; i<na; ++i)
+    {
+        int j = (g-2-i > 0) ? g-2-i : 0;  // first column of b kept
+        int len = nb-j;
+        if(len > 0)
+        {
+            int p = i+j-g+2;
+            w[p+len] = DigitsAddMul1(w+p, b+j, len, a[i]);
+        }
+    }
+
+    for(int i=0; i<k-2; ++i)
+    {
+        w[i] = w[i+2];
+    }
+}
+
+// The low k digits of a * b, where k <= na+nb.
+static void MulLow(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb,
+                   int k)
+{
+    for(int i=0; i<k; ++i)
+    {
+        w[i] = 0;
+    }
+
+    for(int i=0; i<na && i<k; ++i)
+    {
+        int len = (nb < k-i) ? nb : k-i;
+        DIGIT c = DigitsAddMul1(w+i, b, len, a[i]);
+        if(i+len < k)
+        {
+            w[i+len] = c;
+        }
+    }
+}
+
+// The quotient estimate q3 is at most three below the true quotient, so
+// the remainder fits in n+1 digits and only those are worked out. Small
+// moduli form only the half of each product that is used.
+// Algorithm based on Menezes, 14.42, p. 604.
+void DigitsModBarrett(DIGIT* r, const DIGIT* x, int nx, const DIGIT* m, int n,
+                      const DIGIT* mu, int nmu)
+{
+    ScratchMark mark;
+    bool isHalf = (n < gThresholds.mMulKaratsuba);
+
+    // q3 = floor(floor(x / B^(n-1)) mu / B^(n+1)).
+    int n1 = nx-n+1;
+    int n3 = n1+nmu-n-1;
+    DIGIT* q3 = ScratchAlloc(n1+nmu+2);
+    if(isHalf && n >= 2)
+    {
+        MulHigh(q3, x+n-1, n1, mu, nmu, n+1);
+    }
+    else
+    {
+        DigitsMulN(q3, x+n-1, n1, mu, nmu);
+        q3 += n+1;
+    }
+
+    // Only the low n+1 digits of q3 reach the low n+1 digits of q3 m.
+    if(n3 > n+1)
+    {
+        n3 = n+1;
+    }
+    while(n3 > 0 && q3[n3-1] == 0)
+    {
+        --n3;
+    }
+
+    // w = (x - q3 m) mod B^(n+1).
+    DIGIT* w = ScratchAlloc(n+1);
+    for(int i=0; i<=n; ++i)
+    {
+        w[i] = (i < nx) ? x[i] : 0;
+    }
+
+    if(n3 > 0)
+    {
+        DIGIT* t = ScratchAlloc(n3+n);
+        if(isHalf)
+        {
+            MulLow(t, q3, n3, m, n, n+1);
+        }
+        else
+        {
+            DigitsMulN(t, q3, n3, m, n);
+        }
+        DigitsSub(w, w, n+1, t, n+1);
+    }
+
+    // At most three times.
+    while(w[n] != 0 || DigitsCmp(w, m, n) >= 0)
+    {
+        w[n] -= DigitsSub(w, w, n, m, n);
+    }
+
+    for(int i=0; i<n; ++i)
+    {
+        r[i] = w[i];
+    }
+}
+
+/*****************************************************************************/
+// MONTGOMERY PRODUCTS
+/*****************************************************************************/
+
+// Multiply and reduce in one pass per digit of a, with two carries so the
+// two products of a column never overflow a double digit. The quotient
+// digit u is chosen before the pass, from the low digit it must clear.
+// Finely integrated operand scanning, after Koc, C., Acar, T. and
+// Kaliski, B., Analyzing and Comparing Montgomery Multiplication
+// Algorithms, 1996.
+static void MontMulFios(DIGIT* w, const DIGIT* a, const DIGIT* b,
+                        const DIGIT* m, int n, DIGIT minv)
+{
+    ScratchMark mark;
+    DIGIT* t = ScratchAlloc(2*n+1);
+    for(int i=0; i<=2*n; ++i)
+    {
+        t[i] = 0;
+    }
+
+    for(int i=0; i<n; ++i)
+    {
+        DIGIT ai = a[i];
+        DIGIT u = ((t[i] + ai * b[0]) * minv) & DIGIT_MASK;
+        DIGIT c1 = 0;
+        DIGIT c2 = 0;
+
+        for(int j=0; j<n; ++j)
+        {
+            DDIGIT p1 = (DDIGIT)ai * b[j] + t[i+j] + c1;
+            c1 = (DIGIT)(p1 >> SHIFT_VALUE);
+            DDIGIT p2 = (DDIGIT)u * m[j] + ((DIGIT)p1 & DIGIT_MASK) + c2;
+            c2 = (DIGIT)(p2 >> SHIFT_VALUE);
+            t[i+j] = (DIGIT)p2 & DIGIT_MASK;
+        }
+
+        DDIGIT c = (DDIGIT)t[i+n] + c1 + c2;
+        t[i+n] = (DIGIT)c & DIGIT_MASK;
+        t[i+n+1] = (DIGIT)(c >> SHIFT_VALUE);
+    }
+
+    // Below 2m, so once at most.
+    if(t[2*n] != 0 || DigitsCmp(t+n, m, n) >= 0)
+    {
+        DigitsSub(t+n, t+n, n, m, n);
+    }
+
+    for(int i=0; i<n; ++i)
+    {
+        w[i] = t[n+i];
+    }
+}
+
+// Reduce digit by digit, from the bottom up.
+// Algorithm based on Menezes, 14.32, p. 601.
+static void MontRedcSchool(DIGIT* w, DIGIT* t, const DIGIT* m, int n,
+                           DIGIT minv)
+{
+    DIGIT carry = 0;
+
+    for(int i=0; i<n; ++i)
+    {
+        DIGIT u = (t[i] * minv) & DIGIT_MASK;
+        DIGIT c = DigitsAddMul1(t+i, m, n, u);
+        carry += DigitsAdd1(t+i+n, t+i+n, n-i, c);
+    }
+
+    if(carry != 0 || DigitsCmp(t+n, m, n) >= 0)
+    {
+        DigitsSub(t+n, t+n, n, m, n);
+    }
+
+    for(int i=0; i<n; ++i)
+    {
+        w[i] = t[n+i];
+    }
+}
+
+// Reduce all n digits at once: u = t minv mod B^n clears the low half of
+// t + u m. Two products, so it gains from the faster methods.
+static void MontRedcProduct(DIGIT* w, DIGIT* t, const DIGIT* m, int n,
+                            const DIGIT* minv, int nminv)
+{
+    ScratchMark mark;
+    DIGIT* u = ScratchAlloc(n+nminv);
+    DigitsMulN(u, t, n, minv, nminv);
+
+    int nu = n;
+    while(nu > 0 && u[nu-1] == 0)
+    {
+        --nu;
+    }
+
+    DIGIT carry = 0;
+    if(nu > 0)
+    {
+        DIGIT* v = ScratchAlloc(nu+n);
+        DigitsMulN(v, u, nu, m, n);
+        carry = DigitsAdd(t, t, 2*n, v, nu+n);
+    }
+
+    if(carry != 0 || DigitsCmp(t+n, m, n) >= 0)
+    {
+        DigitsSub(t+n, t+n, n, m, n);
+    }
+
+    for(int i=0; i<n; ++i)
+    {
+        w[i] = t[n+i];
+    }
+}
+
+void DigitsMontRedc(DIGIT* w, DIGIT* t, const DIGIT* m, int n,
+                    const DIGIT* minv, int nminv)
+{
+    if(n < gThresholds.mModRedc)
+    {
+        MontRedcSchool(w, t, m, n, minv[0]);
+    }
+    else
+    {
+        MontRedcProduct(w, t, m, n, minv, nminv);
+    }
+}
+
+void DigitsMontMul(DIGIT* w, const DIGIT* a, const DIGIT* b, const DIGIT* m,
+                   int n, const DIGIT* minv, int nminv)
+{
+    if(n < gThresholds.mModRedc)
+    {
+        MontMulFios(w, a, b, m, n, minv[0]);
+        return;
+    }
+
+    ScratchMark mark;
+    DIGIT* t = ScratchAlloc(2*n);
+    DigitsMulN(t, a, n, b, n);
+    MontRedcProduct(w, t, m, n, minv, nminv);
+}
+
+// A square forms each cross product once, see DigitsSqrN, so it is
+// reduced separately.
+void DigitsMontSqr(DIGIT* w, const DIGIT* a, const DIGIT* m, int n,
+                   const DIGIT* minv, int nminv)
+{
+    ScratchMark mark;
+    DIGIT* t = ScratchAlloc(2*n);
+    DigitsSqrN(t, a, n);
+    DigitsMontRedc(w, t, m, n, minv, nminv);
+}
+
+// x = -1/m mod B^n for odd m, by Newton's iteration y' = y (2 - m y),
+// which doubles the correct low digits of y = 1/m at each step.
+static void InverseLow(DIGIT* x, const DIGIT* m, int n)
+{
+    ScratchMark mark;
+    DIGIT* t = ScratchAlloc(3*n);
+    DIGIT* e = ScratchAlloc(n);
+
+    // Any odd digit is its own inverse to 3 bits.
+    DIGIT y = m[0];
+    for(int i=0; i<5; ++i)
+    {
+        y = (y * (2 - m[0] * y)) & DIGIT_MASK;
+    }
+    x[0] = y;
+
+    for(int k=1; k<n; )
+    {
+        int k2 = (2*k < n) ? 2*k : n;
+
+        // e = 2 - m y mod B^k2.
+        DigitsMulN(t, m, k2, x, k);
+        for(int i=0; i<k2; ++i)
+        {
+            e[i] = ~t[i] & DIGIT_MASK;
+        }
+        DigitsAdd1(e, e, k2, 3);
+
+        DigitsMulN(t, x, k, e, k2);
+        for(int i=0; i<k2; ++i)
+        {
+            x[i] = t[i];
+        }
+
+        k = k2;
+    }
+
+    // Negate.
+    for(int i=0; i<n; ++i)
+    {
+        x[i] = ~x[i] & DIGIT_MASK;
+    }
+    DigitsAdd1(x, x, n, 1);
+}
+
+/*****************************************************************************/
+// MODULUS
+/*****************************************************************************/
+
+// The reciprocal and B^(2n) mod m cost one division, made here once.
+MPIModulus::MPIModulus(const MPI& m) : mModulus(m)
+{
+    int n = m.Size();
+
+    if(n > 0)
+    {
+        MPI p(1);
+        p.ShiftLeftBits(2*n*SHIFT_VALUE);
+        p.DivMod(m, &mReciprocal, &mR2);
+    }
+
+    if(IsOdd())
+    {
+        mInverse.Reserve(n);
+        InverseLow(mInverse.mArray, m.mArray, n);
+        mInverse.mSize = n;
+        mInverse.Normalize();
+    }
+    else
+    {
+        mR2.Zero();
+    }
+}
+
+// Values up to twice the length of the modulus, such as the product of
+// two reduced values, are reduced by Barrett's method; longer ones by
+// division.
+void MPIModulus::Reduce(MPI& x) const
+{
+    int n = mModulus.mSize;
+
+    if(n == 0)
+    {
+        x.Zero();
+        x.mIsOverflow = true;
+        return;
+    }
+
+    if(x.mSize < n)
+    {
+        return;
+    }
+
+    if(x.mSize > 2*n)
+    {
+        x %= mModulus;
+        return;
+    }
+
+    DigitsModBarrett(x.mArray, x.mArray, x.mSize, mModulus.mArray, n,
+                     mReciprocal.mArray, mReciprocal.mSize);
+    x.mSize = n;
+    x.mIsOverflow = false;
+    x.Normalize();
+}
+
+// Montgomery product of two reduced values.
+MPI MPIModulus::MontMult(const MPI& x, const MPI& y) const
+{
+    MPI w;
+    int n = mModulus.mSize;
+
+    if(!IsOdd())
+    {
+        w.mIsOverflow = true;
+        return w;
+    }
+
+    ScratchMark mark;
+    DIGIT* a = ScratchAlloc(n);
+    DIGIT* b = ScratchAlloc(n);
+    for(int i=0; i<n; ++i)
+    {
+        a[i] = x.Digit(i);
+        b[i] = y.Digit(i);
+    }
+
+    w.Reserve(n);
+    DigitsMontMul(w.mArray, a, b, mModulus.mArray, n,
+                  mInverse.mArray, mInverse.mSize);
+    w.mSize = n;
+    w.Normalize();
+
+    return w;
+}
+
+// Into the Montgomery domain, x R^2 / R with R = B^n.
+MPI MPIModulus::ToMont(const MPI& x) const
+{
+    MPI r = x;
+    Reduce(r);
+    return MontMult(r, mR2);
+}
+
+// Out of the Montgomery domain.
+MPI MPIModulus::FromMont(const MPI& x) const
+{
+    return MontMult(x, MPI(1));
+}
@@ -0,0 +1,60 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+Modular reduction by a fixed modulus. The reciprocal of the modulus is
+found once, see MPIModulus, and each reduction then estimates the
+quotient from the top digits of the value with one product, takes the
+product of that estimate and the modulus from the value, and corrects by
+subtracting the modulus at most twice. There is no division.
+
+An odd modulus has Montgomery products as well, which reduce from the low
+end: each digit of the inverse of m clears one low digit of the product
+by adding a multiple of m, and the cleared digits are dropped. Small
+moduli interleave the multiply and reduce steps in one pass over the
+digits; larger ones form the product first and reduce it with two more.
+
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpim.h"
+
+#ifndef MPIMMOD_H
+#define MPIMMOD_H
+
+// r = x mod m, Barrett reduction. m has n digits, the top one not zero,
+// and mu = floor(B^(2n) / m) has nmu digits. Needs n <= nx <= 2n.
+// Writes n digits; r may be x.
+void DigitsModBarrett(DIGIT* r, const DIGIT* x, int nx, const DIGIT* m, int n,
+                      const DIGIT* mu, int nmu);
+
+// Montgomery products. m is odd with n digits, and minv = -1/m mod B^n
+// has nminv digits; a and b have n digits each and are less than m.
+// Each writes n digits, less than m, and w may be a or b.
+
+// w = a b / B^n mod m.
+void DigitsMontMul(DIGIT* w, const DIGIT* a, const DIGIT* b, const DIGIT* m,
+                   int n, const DIGIT* minv, int nminv);
+
+// w = a a / B^n mod m.
+void DigitsMontSqr(DIGIT* w, const DIGIT* a, const DIGIT* m, int n,
+                   const DIGIT* minv, int nminv);
+
+// w = t / B^n mod m, for t of 2n digits below m B^n. t is overwritten.
+void DigitsMontRedc(DIGIT* w, DIGIT* t, const DIGIT* m, int n,
+                    const DIGIT* minv, int nminv);
+
+#endif
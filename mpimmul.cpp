@@ -0,0 +1,623 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpimmul.h"
+#include "mpimkern.h"
+#include "mpimpool.h"
+#include "mpimscr.h"
+#include "mpimtune.h"
+
+// Defaults for a backend that has not been tuned.
+#ifndef MUL_KARATSUBA_THRESHOLD
+#define MUL_KARATSUBA_THRESHOLD 32
+#endif
+#ifndef MUL_TOOM3_THRESHOLD
+#define MUL_TOOM3_THRESHOLD 100
+#endif
+#ifndef MUL_TOOM4_THRESHOLD
+#define MUL_TOOM4_THRESHOLD 300
+#endif
+#ifndef MUL_NTT_THRESHOLD
+#define MUL_NTT_THRESHOLD 2000
+#endif
+#ifndef SQR_KARATSUBA_THRESHOLD
+#define SQR_KARATSUBA_THRESHOLD 48
+#endif
+#ifndef MUL_THREADED_THRESHOLD
+#define MUL_THREADED_THRESHOLD 1000
+#endif
+#ifndef DIV_BZ_THRESHOLD
+#define DIV_BZ_THRESHOLD 60
+#endif
+#ifndef DIV_NEWTON_THRESHOLD
+#define DIV_NEWTON_THRESHOLD 50000
+#endif
+#ifndef DIV_EXACT_THRESHOLD
+#define DIV_EXACT_THRESHOLD 100
+#endif
+#ifndef MOD_REDC_THRESHOLD
+#define MOD_REDC_THRESHOLD 60
+#endif
+#ifndef GCD_LEHMER_THRESHOLD
+#define GCD_LEHMER_THRESHOLD 2
+#endif
+#ifndef GCD_HALF_THRESHOLD
+#define GCD_HALF_THRESHOLD 1500
+#endif
+
+MPIThresholds gThresholds =
+{
+    MUL_KARATSUBA_THRESHOLD,
+    MUL_TOOM3_THRESHOLD,
+    MUL_TOOM4_THRESHOLD,
+    MUL_NTT_THRESHOLD,
+    SQR_KARATSUBA_THRESHOLD,
+    MUL_THREADED_THRESHOLD,
+    DIV_BZ_THRESHOLD,
+    DIV_NEWTON_THRESHOLD,
+    DIV_EXACT_THRESHOLD,
+    MOD_REDC_THRESHOLD,
+    GCD_LEHMER_THRESHOLD,
+    GCD_HALF_THRESHOLD
+};
+
+/*****************************************************************************/
+// HELPERS
+/*****************************************************************************/
+
+// w = |a - b|, where na >= nb. Writes na digits.
+// Returns true if b was the larger.
+static bool DigitsAbsDiff(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    // The top of a decides unless it is zero.
+    bool isNeg = false;
+    int i = na-1;
+    while(i >= nb && a[i] == 0)
+    {
+        --i;
+    }
+    if(i < nb)
+    {
+        isNeg = (DigitsCmp(a, b, nb) < 0);
+    }
+
+    if(isNeg)
+    {
+        DigitsSub(w, b, nb, a, nb);
+        for(int j=nb; j<na; ++j)
+        {
+            w[j] = 0;
+        }
+    }
+    else
+    {
+        DigitsSub(w, a, na, b, nb);
+    }
+
+    return isNeg;
+}
+
+// w = a zero extended to nw digits.
+static void DigitsCopy(DIGIT* w, const DIGIT* a, int na, int nw)
+{
+    for(int i=0; i<na; ++i)
+    {
+        w[i] = a[i];
+    }
+    for(int i=na; i<nw; ++i)
+    {
+        w[i] = 0;
+    }
+}
+
+// w += a * n, carrying through nw digits, where nw >= na.
+static void DigitsAddScaled(DIGIT* w, int nw, const DIGIT* a, int na, DIGIT n)
+{
+    DIGIT carry = DigitsAddMul1(w, a, na, n);
+    DigitsAdd1(w+na, w+na, nw-na, carry);
+}
+
+// w -= a * n, borrowing through nw digits, where nw >= na.
+static void DigitsSubScaled(DIGIT* w, int nw, const DIGIT* a, int na, DIGIT n)
+{
+    DIGIT borrow = DigitsSubMul1(w, a, na, n);
+    DigitsSub1(w+na, w+na, nw-na, borrow);
+}
+
+// Negate an n digit two's complement value.
+static void DigitsNeg(DIGIT* w, int n)
+{
+    for(int i=0; i<n; ++i)
+    {
+        w[i] = ~w[i] & DIGIT_MASK;
+    }
+
+    DigitsAdd1(w, w, n, 1);
+}
+
+// Shift an n digit two's complement value down, keeping its sign.
+static void DigitsShrSigned(DIGIT* w, int n, int bits)
+{
+    bool isNeg = (w[n-1] >> (SHIFT_VALUE-1)) & 1;
+
+    DigitsShr(w, w, n, bits);
+    if(isNeg)
+    {
+        w[n-1] |= (DIGIT_MASK << (SHIFT_VALUE-bits)) & DIGIT_MASK;
+    }
+}
+
+// w = a * b for two l digit evaluation points, as a 2l digit two's
+// complement value. The magnitudes leave the top bit clear.
+static void DigitsMulPoint(DIGIT* w, const DIGIT* a, const DIGIT* b, int l, bool isNeg)
+{
+    DigitsMulN(w, a, l, b, l);
+    if(isNeg)
+    {
+        DigitsNeg(w, 2*l);
+    }
+}
+
+// w = a * b, where nb <= (na+1)/2, by cutting a into pieces of nb digits.
+static void DigitsMulBlocks(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    ScratchMark mark;
+    DIGIT* t = ScratchAlloc(2*nb);
+
+    DigitsMulN(w, a, nb, b, nb);
+
+    for(int i=nb; i<na; i+=nb)
+    {
+        int k = (na-i < nb) ? na-i : nb;
+
+        // The new piece overlaps the top nb digits written so far.
+        DigitsMulN(t, a+i, k, b, nb);
+        DIGIT carry = DigitsAdd(w+i, w+i, nb, t, nb);
+        DigitsAdd1(w+i+nb, t+nb, k, carry);
+    }
+}
+
+/*****************************************************************************/
+// MULTIPLICATION
+/*****************************************************************************/
+
+// Multiply, choosing the method by size.
+void DigitsMulN(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    if(a == b && na == nb)
+    {
+        DigitsSqrN(w, a, na);
+        return;
+    }
+
+    // Keep the longer operand first.
+    if(na < nb)
+    {
+        const DIGIT* t = a;
+        a = b;
+        b = t;
+        int n = na;
+        na = nb;
+        nb = n;
+    }
+
+    if(nb < gThresholds.mMulKaratsuba)
+    {
+        DigitsMul(w, a, na, b, nb);
+    }
+    else if(nb >= gThresholds.mMulNtt)
+    {
+        DigitsMulNtt(w, a, na, b, nb);
+    }
+    else if(nb <= (na+1)/2)
+    {
+        DigitsMulBlocks(w, a, na, b, nb);
+    }
+    else if(nb >= gThresholds.mMulToom4 && nb > 3*((na+3)/4))
+    {
+        DigitsMulToom4(w, a, na, b, nb);
+    }
+    else if(nb >= gThresholds.mMulToom3 && nb > 2*((na+2)/3))
+    {
+        DigitsMulToom3(w, a, na, b, nb);
+    }
+    else
+    {
+        DigitsMulKara(w, a, na, b, nb);
+    }
+}
+
+// Square, choosing the method by size. Toom and the transform evaluate a
+// square once themselves.
+void DigitsSqrN(DIGIT* w, const DIGIT* a, int na)
+{
+    if(na < gThresholds.mSqrKaratsuba || na < 2)
+    {
+        DigitsSqr(w, a, na);
+    }
+    else if(na >= gThresholds.mMulNtt)
+    {
+        DigitsMulNtt(w, a, na, a, na);
+    }
+    else if(na >= gThresholds.mMulToom4 && na > 3*((na+3)/4))
+    {
+        DigitsMulToom4(w, a, na, a, na);
+    }
+    else if(na >= gThresholds.mMulToom3 && na > 2*((na+2)/3))
+    {
+        DigitsMulToom3(w, a, na, a, na);
+    }
+    else
+    {
+        DigitsSqrKara(w, a, na);
+    }
+}
+
+// Multiply, Karatsuba. Splits both operands at l = (na+1)/2 digits, so
+// a = a1*B^l + a0 and b = b1*B^l + b0, and uses
+//   a0*b1 + a1*b0 = a0*b0 + a1*b1 + (a0 - a1)*(b1 - b0),
+// which needs three products instead of four. The low and high products
+// are written straight into w, and the middle sum is added in place.
+// Algorithm based on Knuth, 4.3.3, p. 295.
+void DigitsMulKara(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    ScratchMark mark;
+    int l = (na+1)/2;  // low half size
+    int ha = na-l;     // high half sizes, at most l
+    int hb = nb-l;
+    int n = na+nb;
+
+    // Differences of the halves, each at most l digits.
+    DIGIT* da = ScratchAlloc(l);
+    DIGIT* db = ScratchAlloc(l);
+    bool isNeg = DigitsAbsDiff(da, a, l, a+l, ha);
+    isNeg ^= !DigitsAbsDiff(db, b, l, b+l, hb);
+
+    // Low and high products, and the middle one.
+    DIGIT* t = ScratchAlloc(2*l+1);
+    TaskGroup tasks(nb >= gThresholds.mMulThreaded);
+    tasks.Run([=] { DigitsMulN(w, a, l, b, l); });
+    tasks.Run([=] { DigitsMulN(w+2*l, a+l, ha, b+l, hb); });
+    tasks.Run([=] { DigitsMulN(t, da, l, db, l); });
+    tasks.Wait();
+    t[2*l] = 0;
+
+    // Middle sum, a0*b1 + a1*b0, fits in 2l+1 digits.
+    DIGIT* m = ScratchAlloc(2*l+1);
+    m[2*l] = DigitsAdd(m, w, 2*l, w+2*l, n-2*l);
+    if(isNeg)
+    {
+        DigitsSub(m, m, 2*l+1, t, 2*l+1);
+    }
+    else
+    {
+        DigitsAdd(m, m, 2*l+1, t, 2*l+1);
+    }
+
+    // Add it in at l digits; the full product can not carry out of n.
+    int k = (n-l < 2*l+1) ? n-l : 2*l+1;
+    DigitsAdd(w+l, w+l, n-l, m, k);
+}
+
+// Square, Karatsuba. With a = a1*B^l + a0,
+//   2*a0*a1 = a0^2 + a1^2 - (a0 - a1)^2,
+// so the three smaller products are all squares.
+// Algorithm based on Knuth, 4.3.3, p. 295.
+void DigitsSqrKara(DIGIT* w, const DIGIT* a, int na)
+{
+    ScratchMark mark;
+    int l = (na+1)/2;  // low half size
+    int h = na-l;      // high half size, at most l
+    int n = 2*na;
+
+    DIGIT* d = ScratchAlloc(l);
+    DigitsAbsDiff(d, a, l, a+l, h);
+
+    // Low and high squares, and the middle one.
+    DIGIT* t = ScratchAlloc(2*l+1);
+    TaskGroup tasks(na >= gThresholds.mMulThreaded);
+    tasks.Run([=] { DigitsSqrN(w, a, l); });
+    tasks.Run([=] { DigitsSqrN(w+2*l, a+l, h); });
+    tasks.Run([=] { DigitsSqrN(t, d, l); });
+    tasks.Wait();
+    t[2*l] = 0;
+
+    // Middle sum, 2*a0*a1, fits in 2l+1 digits.
+    DIGIT* m = ScratchAlloc(2*l+1);
+    m[2*l] = DigitsAdd(m, w, 2*l, w+2*l, n-2*l);
+    DigitsSub(m, m, 2*l+1, t, 2*l+1);
+
+    // Add it in at l digits; the full square can not carry out of n.
+    int k = (n-l < 2*l+1) ? n-l : 2*l+1;
+    DigitsAdd(w+l, w+l, n-l, m, k);
+}
+
+// Evaluation points for Toom-3, each l digits, at 1, -1 and -2.
+struct Toom3Points
+{
+    DIGIT* mP1;
+    DIGIT* mM1;
+    DIGIT* mM2;
+    bool mIsNegM1;
+    bool mIsNegM2;
+};
+
+// Evaluate x = x2*B^2k + x1*B^k + x0 at 1, -1 and -2.
+static void Toom3Eval(Toom3Points& p, const DIGIT* x, int nx, int k)
+{
+    int l = k+1;
+    const DIGIT* x0 = x;
+    const DIGIT* x1 = x+k;
+    const DIGIT* x2 = x+2*k;
+    int n2 = nx-2*k;
+
+    p.mP1 = ScratchAlloc(l);
+    p.mM1 = ScratchAlloc(l);
+    p.mM2 = ScratchAlloc(l);
+    DIGIT* e = ScratchAlloc(l);
+    DIGIT* o = ScratchAlloc(l);
+
+    // x0 + x2, then add and take away x1.
+    DigitsCopy(e, x0, k, l);
+    DigitsAdd(e, e, l, x2, n2);
+    DigitsAdd(p.mP1, e, l, x1, k);
+    p.mIsNegM1 = DigitsAbsDiff(p.mM1, e, l, x1, k);
+
+    // x0 + 4*x2, less 2*x1.
+    DigitsCopy(e, x0, k, l);
+    DigitsAddScaled(e, l, x2, n2, 4);
+    o[k] = DigitsShl(o, x1, k, 1);
+    p.mIsNegM2 = DigitsAbsDiff(p.mM2, e, l, o, l);
+}
+
+// Multiply, Toom-3. Splits both operands into three pieces of k digits,
+// evaluates them at 0, 1, -1, -2 and infinity, and recovers the five
+// coefficients of the product from the five smaller products. The
+// interpolation runs on 2k+2 digit two's complement values.
+// Algorithm based on Bodrato and Zanoni, Integer and Polynomial
+// Multiplication: Towards Optimal Toom-Cook Matrices, 2007.
+void DigitsMulToom3(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    ScratchMark mark;
+    int k = (na+2)/3;  // piece size
+    int l = k+1;       // evaluation size
+    int m = 2*l;       // product size
+    int n = na+nb;
+    bool isSqr = (a == b && na == nb);
+
+    Toom3Points pa;
+    Toom3Points pb;
+    Toom3Eval(pa, a, na, k);
+    if(isSqr)
+    {
+        pb = pa;
+    }
+    else
+    {
+        Toom3Eval(pb, b, nb, k);
+    }
+
+    // Products at 0 and infinity go straight into the result.
+    DIGIT* r0 = w;
+    DIGIT* ri = w+4*k;
+    int ni = n-4*k;
+    DIGIT* r1 = ScratchAlloc(m);
+    DIGIT* r2 = ScratchAlloc(m);
+    DIGIT* r3 = ScratchAlloc(m);
+    DIGIT* rm1 = ScratchAlloc(m);
+
+    TaskGroup tasks(nb >= gThresholds.mMulThreaded);
+    tasks.Run([=] { DigitsMulN(r0, a, k, b, k); });
+    tasks.Run([=] { DigitsMulN(ri, a+2*k, na-2*k, b+2*k, nb-2*k); });
+    tasks.Run([=] { DigitsMulPoint(r1, pa.mP1, pb.mP1, l, false); });
+    tasks.Run([=] { DigitsMulPoint(rm1, pa.mM1, pb.mM1, l, pa.mIsNegM1 != pb.mIsNegM1); });
+    tasks.Run([=] { DigitsMulPoint(r3, pa.mM2, pb.mM2, l, pa.mIsNegM2 != pb.mIsNegM2); });
+    tasks.Wait();
+
+    // r3 = (r(-2) - r(1)) / 3
+    DigitsSub(r3, r3, m, r1, m);
+    DigitsDivExact1(r3, r3, m, 3);
+
+    // r1 = (r(1) - r(-1)) / 2
+    DigitsSub(r1, r1, m, rm1, m);
+    DigitsShrSigned(r1, m, 1);
+
+    // r2 = r(-1) - r(0)
+    DigitsSub(r2, rm1, m, r0, 2*k);
+
+    // r3 = (r2 - r3) / 2 + 2 * r(inf)
+    DigitsSub(rm1, r2, m, r3, m);
+    DigitsShrSigned(rm1, m, 1);
+    DigitsAddScaled(rm1, m, ri, ni, 2);
+    r3 = rm1;
+
+    // r2 = r2 + r1 - r(inf)
+    DigitsAdd(r2, r2, m, r1, m);
+    DigitsSub(r2, r2, m, ri, ni);
+
+    // r1 = r1 - r3
+    DigitsSub(r1, r1, m, r3, m);
+
+    // Put the middle coefficients in place; each is non-negative now, and
+    // no carry leaves the full product.
+    DigitsCopy(w+2*k, r2, 2*k, 2*k);
+    DigitsAdd(w+4*k, w+4*k, ni, r2+2*k, 2);
+    DigitsAdd(w+k, w+k, n-k, r1, (m < n-k) ? m : n-k);
+    DigitsAdd(w+3*k, w+3*k, n-3*k, r3, (m < n-3*k) ? m : n-3*k);
+}
+
+// Evaluation points for Toom-4, each l digits, at 1, -1, 2, -2 and 1/2.
+struct Toom4Points
+{
+    DIGIT* mP1;
+    DIGIT* mM1;
+    DIGIT* mP2;
+    DIGIT* mM2;
+    DIGIT* mPH;
+    bool mIsNegM1;
+    bool mIsNegM2;
+};
+
+// Evaluate x = x3*B^3k + x2*B^2k + x1*B^k + x0 at 1, -1, 2, -2, and at 1/2
+// scaled by 8.
+static void Toom4Eval(Toom4Points& p, const DIGIT* x, int nx, int k)
+{
+    int l = k+1;
+    const DIGIT* x0 = x;
+    const DIGIT* x1 = x+k;
+    const DIGIT* x2 = x+2*k;
+    const DIGIT* x3 = x+3*k;
+    int n3 = nx-3*k;
+
+    p.mP1 = ScratchAlloc(l);
+    p.mM1 = ScratchAlloc(l);
+    p.mP2 = ScratchAlloc(l);
+    p.mM2 = ScratchAlloc(l);
+    p.mPH = ScratchAlloc(l);
+    DIGIT* e = ScratchAlloc(l);
+    DIGIT* o = ScratchAlloc(l);
+
+    // Even and odd parts at 1.
+    DigitsCopy(e, x0, k, l);
+    DigitsAdd(e, e, l, x2, k);
+    DigitsCopy(o, x1, k, l);
+    DigitsAdd(o, o, l, x3, n3);
+    DigitsAdd(p.mP1, e, l, o, l);
+    p.mIsNegM1 = DigitsAbsDiff(p.mM1, e, l, o, l);
+
+    // Even and odd parts at 2.
+    DigitsCopy(e, x0, k, l);
+    DigitsAddScaled(e, l, x2, k, 4);
+    o[k] = DigitsShl(o, x1, k, 1);
+    DigitsAddScaled(o, l, x3, n3, 8);
+    DigitsAdd(p.mP2, e, l, o, l);
+    p.mIsNegM2 = DigitsAbsDiff(p.mM2, e, l, o, l);
+
+    // 8*x0 + 4*x1 + 2*x2 + x3.
+    DigitsCopy(p.mPH, x3, n3, l);
+    DigitsAddScaled(p.mPH, l, x2, k, 2);
+    DigitsAddScaled(p.mPH, l, x1, k, 4);
+    DigitsAddScaled(p.mPH, l, x0, k, 8);
+}
+
+// Multiply, Toom-4. Splits both operands into four pieces of k digits,
+// evaluates them at 0, 1, -1, 2, -2, 1/2 and infinity, and recovers the
+// seven coefficients of the product from the seven smaller products.
+// The even and odd coefficients are separated first; the interpolation
+// runs on 2k+2 digit two's complement values, with exact divisions by
+// 2, 3 and 5 only.
+// Algorithm based on Bodrato and Zanoni, Integer and Polynomial
+// Multiplication: Towards Optimal Toom-Cook Matrices, 2007.
+void DigitsMulToom4(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    ScratchMark mark;
+    int k = (na+3)/4;  // piece size
+    int l = k+1;       // evaluation size
+    int m = 2*l;       // product size
+    int n = na+nb;
+    bool isSqr = (a == b && na == nb);
+
+    Toom4Points pa;
+    Toom4Points pb;
+    Toom4Eval(pa, a, na, k);
+    if(isSqr)
+    {
+        pb = pa;
+    }
+    else
+    {
+        Toom4Eval(pb, b, nb, k);
+    }
+
+    // Products at 0 and infinity go straight into the result.
+    DIGIT* r0 = w;
+    DIGIT* ri = w+6*k;
+    int ni = n-6*k;
+    DIGIT* r1 = ScratchAlloc(m);
+    DIGIT* rm1 = ScratchAlloc(m);
+    DIGIT* r2 = ScratchAlloc(m);
+    DIGIT* rm2 = ScratchAlloc(m);
+    DIGIT* rh = ScratchAlloc(m);
+    DIGIT* t1 = ScratchAlloc(m);
+    DIGIT* t2 = ScratchAlloc(m);
+
+    TaskGroup tasks(nb >= gThresholds.mMulThreaded);
+    tasks.Run([=] { DigitsMulN(r0, a, k, b, k); });
+    tasks.Run([=] { DigitsMulN(ri, a+3*k, na-3*k, b+3*k, nb-3*k); });
+    tasks.Run([=] { DigitsMulPoint(r1, pa.mP1, pb.mP1, l, false); });
+    tasks.Run([=] { DigitsMulPoint(rm1, pa.mM1, pb.mM1, l, pa.mIsNegM1 != pb.mIsNegM1); });
+    tasks.Run([=] { DigitsMulPoint(r2, pa.mP2, pb.mP2, l, false); });
+    tasks.Run([=] { DigitsMulPoint(rm2, pa.mM2, pb.mM2, l, pa.mIsNegM2 != pb.mIsNegM2); });
+    tasks.Run([=] { DigitsMulPoint(rh, pa.mPH, pb.mPH, l, false); });
+    tasks.Wait();
+
+    // Odd parts: t1 = c1 + c3 + c5, t2 = c1 + 4*c3 + 16*c5.
+    DigitsSub(t1, r1, m, rm1, m);
+    DigitsShrSigned(t1, m, 1);
+    DigitsSub(t2, r2, m, rm2, m);
+    DigitsShrSigned(t2, m, 2);
+
+    // Even parts: r1 = c2 + c4, r2 = c2 + 4*c4.
+    DigitsAdd(r1, r1, m, rm1, m);
+    DigitsShrSigned(r1, m, 1);
+    DigitsSub(r1, r1, m, r0, 2*k);
+    DigitsSub(r1, r1, m, ri, ni);
+    DigitsAdd(r2, r2, m, rm2, m);
+    DigitsShrSigned(r2, m, 1);
+    DigitsSub(r2, r2, m, r0, 2*k);
+    DigitsSubScaled(r2, m, ri, ni, 64);
+    DigitsShrSigned(r2, m, 2);
+
+    // c4 in r2, c2 in r1.
+    DigitsSub(r2, r2, m, r1, m);
+    DigitsDivExact1(r2, r2, m, 3);
+    DigitsSub(r1, r1, m, r2, m);
+
+    // rh = 16*c1 + 4*c3 + c5, from the point at 1/2.
+    DigitsSubScaled(rh, m, r0, 2*k, 64);
+    DigitsSubScaled(rh, m, r1, m, 16);
+    DigitsSubScaled(rh, m, r2, m, 4);
+    DigitsSub(rh, rh, m, ri, ni);
+    DigitsShrSigned(rh, m, 1);
+
+    // t2 = c3 + 5*c5, rm1 = 4*c3 + 5*c5.
+    DigitsSub(t2, t2, m, t1, m);
+    DigitsDivExact1(t2, t2, m, 3);
+    DigitsShl(rm1, t1, m, 4);
+    DigitsSub(rm1, rm1, m, rh, m);
+    DigitsDivExact1(rm1, rm1, m, 3);
+
+    // c3 in rm1, c5 in t2, c1 in t1.
+    DigitsSub(rm1, rm1, m, t2, m);
+    DigitsDivExact1(rm1, rm1, m, 3);
+    DigitsSub(t2, t2, m, rm1, m);
+    DigitsDivExact1(t2, t2, m, 5);
+    DigitsSub(t1, t1, m, rm1, m);
+    DigitsSub(t1, t1, m, t2, m);
+
+    // Put the coefficients in place; each is non-negative now, and no
+    // carry leaves the full product.
+    DigitsCopy(w+2*k, r1, 2*k, 2*k);
+    DigitsCopy(w+4*k, r2, 2*k, 2*k);
+    DigitsAdd(w+4*k, w+4*k, n-4*k, r1+2*k, 2);
+    DigitsAdd(w+6*k, w+6*k, ni, r2+2*k, 2);
+    DigitsAdd(w+k, w+k, n-k, t1, (m < n-k) ? m : n-k);
+    DigitsAdd(w+3*k, w+3*k, n-3*k, rm1, (m < n-3*k) ? m : n-3*k);
+    DigitsAdd(w+5*k, w+5*k, n-5*k, t2, (m < n-5*k) ? m : n-5*k);
+}
@@ -0,0 +1,103 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+Multiplication of digit vectors. DigitsMulN picks a method by operand
+size: schoolbook below the Karatsuba threshold, then Karatsuba, Toom-3,
+Toom-4 and finally a number theoretic transform as the operands grow.
+Below the transform, operands of very different length are cut into
+balanced pieces first. Squares have their own schoolbook and Karatsuba
+methods, which form each cross product once, with a separate threshold.
+
+Above mMulThreaded the smaller products of Karatsuba and Toom, and the
+transforms, are spread over the threads of the pool in mpimpool.h. The
+product is the same whatever the number of threads.
+
+The thresholds start from the values in mpimtune.h, which "make tune"
+measures on the host and regenerates. They can also be changed at run
+time through gThresholds, eg. by a program that tunes itself; they are
+read without locking, so change them before starting other threads.
+
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpim.h"
+
+#ifndef MPIMMUL_H
+#define MPIMMUL_H
+
+// Operand sizes, in digits, at which each method takes over.
+struct MPIThresholds
+{
+    int mMulKaratsuba;  // smaller operand size for Karatsuba
+    int mMulToom3;      // smaller operand size for Toom-3
+    int mMulToom4;      // smaller operand size for Toom-4
+    int mMulNtt;        // smaller operand size for the transform
+    int mSqrKaratsuba;  // operand size for Karatsuba squaring
+    int mMulThreaded;   // smaller operand size for running the smaller
+                        // products as tasks, see mpimpool.h
+    int mDivBZ;         // divisor and quotient size for recursive
+                        // division, see mpimdiv.h
+    int mDivNewton;     // divisor size for division by reciprocal
+    int mDivExact;      // quotient size for exact division from both
+                        // ends, see mpimdiv.h
+    int mModRedc;       // modulus size for Montgomery reduction by
+                        // products, see mpimmod.h
+    int mGcdLehmer;     // size for Lehmer's gcd over the binary method,
+                        // see mpimgcd.h
+    int mGcdHalf;       // size for the half gcd recursion
+};
+
+extern MPIThresholds gThresholds;
+
+// w = a * b, method chosen by size. Writes na+nb digits. A square, with
+// a and b the same, goes to DigitsSqrN.
+// Needs na, nb >= 1, and w must not overlap a or b.
+void DigitsMulN(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb);
+
+// w = a * a, method chosen by size. Writes 2*na digits.
+// Needs na >= 1, and w must not overlap a.
+void DigitsSqrN(DIGIT* w, const DIGIT* a, int na);
+
+// w = a * b, one level of Karatsuba, with the three smaller products done
+// by DigitsMulN. Writes na+nb digits.
+// Needs na >= nb > (na+1)/2, and w must not overlap a or b.
+void DigitsMulKara(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb);
+
+// w = a * a, one level of Karatsuba, with the three smaller squares done
+// by DigitsSqrN. Writes 2*na digits.
+// Needs na >= 2, and w must not overlap a.
+void DigitsSqrKara(DIGIT* w, const DIGIT* a, int na);
+
+// w = a * b, one level of Toom-3, with the five smaller products done by
+// DigitsMulN. A square, with a and b the same, is evaluated once.
+// Writes na+nb digits.
+// Needs na >= nb > 2*ceil(na/3), and w must not overlap a or b.
+void DigitsMulToom3(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb);
+
+// w = a * b, one level of Toom-4, with the seven smaller products done by
+// DigitsMulN. A square, with a and b the same, is evaluated once.
+// Writes na+nb digits.
+// Needs na >= nb > 3*ceil(na/4), and w must not overlap a or b.
+void DigitsMulToom4(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb);
+
+// w = a * b, by number theoretic transform modulo three primes, see
+// mpimntt.cpp. A square, with a and b the same, is transformed once.
+// Writes na+nb digits.
+// Needs na, nb >= 1, and w must not overlap a or b.
+void DigitsMulNtt(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb);
+
+#endif
@@ -0,0 +1,481 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+Multiplication by number theoretic transform. The digits of each operand
+are the coefficients of a polynomial, and the product is their cyclic
+convolution, computed by transforms modulo three primes just below 2^62.
+Each coefficient of the convolution is below n * B^2, far less than the
+product of the primes, so the Chinese remainder theorem recovers it
+exactly, and the carries are propagated as the digits are written.
+
+Arithmetic modulo each prime is done in Montgomery form, so no division
+is needed; the data stays in ordinary form, and only the roots of unity
+and constants are kept in Montgomery form.
+
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpimmul.h"
+#include "mpimpool.h"
+#include "mpimscr.h"
+
+typedef unsigned long long WORD;    // residue modulo a prime
+typedef unsigned __int128 DWORD;    // product of two residues
+
+// A transform prime, p = c * 2^50 + 1, with its constants. Transforms of
+// up to 2^50 points have the roots of unity they need.
+struct NttPrime
+{
+    WORD mP;     // the prime, below 2^62
+    WORD mRoot;  // primitive root, in Montgomery form
+    WORD mNInv;  // -1/p modulo 2^64
+    WORD mR2;    // 2^128 modulo p
+    WORD mOne;   // 1 in Montgomery form
+};
+
+/*****************************************************************************/
+// ARITHMETIC MODULO A PRIME
+/*****************************************************************************/
+
+// a * b / 2^64 modulo p, for a below 2^64 and b below p.
+// Algorithm based on Montgomery, Modular Multiplication Without Trial
+// Division, 1985.
+static inline WORD MulRedc(WORD a, WORD b, const NttPrime& q)
+{
+    DWORD t = (DWORD)a * b;
+    WORD m = (WORD)t * q.mNInv;
+    WORD u = (WORD)((t + (DWORD)m * q.mP) >> 64);
+
+    return (u >= q.mP) ? u - q.mP : u;
+}
+
+// As MulRedc, but for a below 4p and without the final reduction: the
+// result is below 2p.
+static inline WORD MulRedcLazy(WORD a, WORD b, const NttPrime& q)
+{
+    DWORD t = (DWORD)a * b;
+    WORD m = (WORD)t * q.mNInv;
+
+    return (WORD)((t + (DWORD)m * q.mP) >> 64);
+}
+
+static inline WORD AddMod(WORD a, WORD b, const NttPrime& q)
+{
+    WORD s = a + b;
+    return (s >= q.mP) ? s - q.mP : s;
+}
+
+static inline WORD SubMod(WORD a, WORD b, const NttPrime& q)
+{
+    return (a >= b) ? a - b : a + q.mP - b;
+}
+
+// Reduce a value below 2p.
+static inline WORD Reduce(WORD a, const NttPrime& q)
+{
+    return (a >= q.mP) ? a - q.mP : a;
+}
+
+// Convert to Montgomery form.
+static inline WORD ToMont(WORD a, const NttPrime& q)
+{
+    return MulRedc(a, q.mR2, q);
+}
+
+// Power of a value in Montgomery form.
+static WORD PowMont(WORD a, WORD e, const NttPrime& q)
+{
+    WORD w = q.mOne;
+
+    while(e)
+    {
+        if(e & 1)
+        {
+            w = MulRedc(w, a, q);
+        }
+
+        a = MulRedc(a, a, q);
+        e >>= 1;
+    }
+
+    return w;
+}
+
+// Inverse in Montgomery form, by Fermat's little theorem.
+static WORD InvMont(WORD a, const NttPrime& q)
+{
+    return PowMont(a, q.mP-2, q);
+}
+
+// Fill in the constants for p with primitive root g.
+static NttPrime MakePrime(WORD p, WORD g)
+{
+    NttPrime q;
+
+    q.mP = p;
+
+    // Newton's iteration for 1/p modulo 2^64.
+    WORD inv = p;
+    for(int i=0; i<6; ++i)
+    {
+        inv *= 2 - p * inv;
+    }
+    q.mNInv = -inv;
+
+    WORD r = (WORD)((((DWORD)1) << 64) % p);
+    q.mR2 = (WORD)(((DWORD)r * r) % p);
+    q.mOne = r;
+    q.mRoot = ToMont(g, q);
+
+    return q;
+}
+
+static const NttPrime gPrime[3] =
+{
+    MakePrime(0x3FDC000000000001ULL, 3),
+    MakePrime(0x3F18000000000001ULL, 10),
+    MakePrime(0x3EC4000000000001ULL, 37)
+};
+
+/*****************************************************************************/
+// TRANSFORMS
+/*****************************************************************************/
+
+// Roots of unity for each level of a transform of n = 2^logn points, in
+// Montgomery form: w[len+j] = root^j for a root of order 2*len, j < len,
+// so every level reads its roots in sequence. iw holds the inverses.
+static void NttRoots(WORD* w, WORD* iw, int logn, const NttPrime& q)
+{
+    int n = 1 << logn;
+    int h = n / 2;
+    WORD root = PowMont(q.mRoot, (q.mP-1) >> logn, q);
+
+    w[h] = q.mOne;
+    for(int j=1; j<h; ++j)
+    {
+        w[h+j] = MulRedc(w[h+j-1], root, q);
+    }
+    for(int len=h/2; len>=1; len/=2)
+    {
+        for(int j=0; j<len; ++j)
+        {
+            w[len+j] = w[2*len+2*j];
+        }
+    }
+
+    // root^-j = -root^(len-j)
+    for(int len=1; len<n; len*=2)
+    {
+        iw[len] = q.mOne;
+        for(int j=1; j<len; ++j)
+        {
+            iw[len+j] = q.mP - w[2*len-j];
+        }
+    }
+}
+
+// One level of the forward transform, decimation in frequency, on the
+// butterflies lo <= j < hi of each block of 2*len residues.
+// Residues are kept below 2p rather than p, which the primes below 2^62
+// leave room for, saving most of the reductions.
+// Algorithm based on Harvey, Faster arithmetic for number-theoretic
+// transforms, 2014.
+static void NttForwardLevel(WORD* a, int n, int len, int lo, int hi,
+                            const WORD* w, const NttPrime q)
+{
+    WORD p2 = 2 * q.mP;
+    const WORD* wl = w + len;
+
+    for(int i=0; i<n; i+=2*len)
+    {
+        WORD* x = a + i;
+        WORD* y = a + i + len;
+
+        for(int j=lo; j<hi; ++j)
+        {
+            WORD u = x[j];
+            WORD v = y[j];
+            WORD s = u + v;
+
+            x[j] = (s >= p2) ? s - p2 : s;
+            y[j] = MulRedcLazy(u - v + p2, wl[j], q);
+        }
+    }
+}
+
+// One level of the inverse transform, decimation in time, likewise.
+static void NttInverseLevel(WORD* a, int n, int len, int lo, int hi,
+                            const WORD* iw, const NttPrime q)
+{
+    WORD p2 = 2 * q.mP;
+    const WORD* wl = iw + len;
+
+    for(int i=0; i<n; i+=2*len)
+    {
+        WORD* x = a + i;
+        WORD* y = a + i + len;
+
+        for(int j=lo; j<hi; ++j)
+        {
+            WORD u = x[j];
+            WORD v = MulRedcLazy(y[j], wl[j], q);
+            WORD s = u + v;
+            WORD d = u - v + p2;
+
+            x[j] = (s >= p2) ? s - p2 : s;
+            y[j] = (d >= p2) ? d - p2 : d;
+        }
+    }
+}
+
+// Size of the blocks a parallel transform hands out whole, or n if it
+// should not be split. Above it each level is split among the threads.
+static int NttBlock(int n, bool isParallel)
+{
+    int threads = GetThreadCount();
+    if(!isParallel || threads == 1)
+    {
+        return n;
+    }
+
+    int block = 4096;
+    while(block < n && block < n / (4*threads))
+    {
+        block *= 2;
+    }
+
+    return block;
+}
+
+// Forward transform of n = 2^logn residues. The result is in bit reversed
+// order, which the pointwise product and the inverse transform accept as
+// it is.
+static void NttForward(WORD* a, int logn, const WORD* w, const NttPrime& q, bool isParallel)
+{
+    int n = 1 << logn;
+    int block = NttBlock(n, isParallel);
+    int threads = GetThreadCount();
+
+    // Levels whose blocks are larger than a task, split by butterfly.
+    for(int len=n/2; len>=block; len/=2)
+    {
+        ParallelFor(0, len, len / threads, [=](int lo, int hi)
+        {
+            NttForwardLevel(a, n, len, lo, hi, w, q);
+        });
+    }
+
+    // The rest, a task per block.
+    ParallelFor(0, n, block, [=](int lo, int hi)
+    {
+        for(int len=(hi-lo)/2; len>=1; len/=2)
+        {
+            NttForwardLevel(a+lo, hi-lo, len, 0, len, w, q);
+        }
+    }, block < n);
+}
+
+// Inverse transform, from bit reversed order back to natural order. The
+// result still needs dividing by n.
+static void NttInverse(WORD* a, int logn, const WORD* iw, const NttPrime& q, bool isParallel)
+{
+    int n = 1 << logn;
+    int block = NttBlock(n, isParallel);
+    int threads = GetThreadCount();
+
+    ParallelFor(0, n, block, [=](int lo, int hi)
+    {
+        for(int len=1; len<hi-lo; len*=2)
+        {
+            NttInverseLevel(a+lo, hi-lo, len, 0, len, iw, q);
+        }
+    }, block < n);
+
+    for(int len=block; len<n; len*=2)
+    {
+        ParallelFor(0, len, len / threads, [=](int lo, int hi)
+        {
+            NttInverseLevel(a, n, len, lo, hi, iw, q);
+        });
+    }
+}
+
+// Load digits as residues, zero padded to n.
+static void NttLoad(WORD* r, const DIGIT* a, int na, int n, const NttPrime& q)
+{
+    for(int i=0; i<na; ++i)
+    {
+        // A digit is below 2^64 < 6p; two steps bring it below 2p.
+        WORD x = a[i];
+        x = (x >= 2*q.mP) ? x - 2*q.mP : x;
+        r[i] = (x >= 2*q.mP) ? x - 2*q.mP : x;
+    }
+    for(int i=na; i<n; ++i)
+    {
+        r[i] = 0;
+    }
+}
+
+// Get n residues from the scratch arena.
+static WORD* WordAlloc(int n)
+{
+    return (WORD*)ScratchAlloc((n * sizeof(WORD) + sizeof(DIGIT) - 1) / sizeof(DIGIT));
+}
+
+// Convolution of a and b modulo one prime, left in r. A square, with a
+// and b the same, is transformed once.
+static void NttConvolve(WORD* r, int logn, const DIGIT* a, int na,
+                        const DIGIT* b, int nb, const NttPrime& q, bool isParallel)
+{
+    ScratchMark mark;
+    int n = 1 << logn;
+    bool isSqr = (a == b && na == nb);
+    int grain = NttBlock(n, isParallel);
+
+    WORD* w = WordAlloc(n);
+    WORD* iw = WordAlloc(n);
+    NttRoots(w, iw, logn, q);
+
+    NttLoad(r, a, na, n, q);
+    NttForward(r, logn, w, q, isParallel);
+
+    if(isSqr)
+    {
+        ParallelFor(0, n, grain, [=](int lo, int hi)
+        {
+            for(int i=lo; i<hi; ++i)
+            {
+                r[i] = MulRedc(r[i], r[i], q);
+            }
+        }, grain < n);
+    }
+    else
+    {
+        WORD* t = WordAlloc(n);
+        NttLoad(t, b, nb, n, q);
+        NttForward(t, logn, w, q, isParallel);
+
+        ParallelFor(0, n, grain, [=](int lo, int hi)
+        {
+            for(int i=lo; i<hi; ++i)
+            {
+                r[i] = MulRedc(r[i], t[i], q);
+            }
+        }, grain < n);
+    }
+
+    NttInverse(r, logn, iw, q, isParallel);
+
+    // Each pointwise product lost a factor of 2^64; put it back with
+    // the division by n.
+    WORD s = InvMont(ToMont((WORD)n, q), q);
+    s = MulRedc(s, q.mR2, q);
+    ParallelFor(0, n, grain, [=](int lo, int hi)
+    {
+        for(int i=lo; i<hi; ++i)
+        {
+            r[i] = MulRedc(r[i], s, q);
+        }
+    }, grain < n);
+}
+
+/*****************************************************************************/
+// MULTIPLICATION
+/*****************************************************************************/
+
+// Multiply by convolution modulo three primes, then combine the residues
+// of each coefficient and carry them into the digits of w.
+// Algorithm based on Knuth, 4.3.3, p. 305, and Garner's method for the
+// Chinese remainder theorem, Knuth, 4.3.2, p. 290.
+void DigitsMulNtt(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    ScratchMark mark;
+    const NttPrime& q1 = gPrime[0];
+    const NttPrime& q2 = gPrime[1];
+    const NttPrime& q3 = gPrime[2];
+
+    // Transform size, enough for the whole convolution to not wrap.
+    int nc = na+nb-1;
+    int logn = 0;
+    while((1 << logn) < nc)
+    {
+        ++logn;
+    }
+    int n = 1 << logn;
+
+    WORD* r1 = WordAlloc(n);
+    WORD* r2 = WordAlloc(n);
+    WORD* r3 = WordAlloc(n);
+
+    // The primes are independent, and each transform can be split too.
+    bool isParallel = (na < nb ? na : nb) >= gThresholds.mMulThreaded;
+    TaskGroup tasks(isParallel);
+    tasks.Run([=] { NttConvolve(r1, logn, a, na, b, nb, q1, isParallel); });
+    tasks.Run([=] { NttConvolve(r2, logn, a, na, b, nb, q2, isParallel); });
+    tasks.Run([=] { NttConvolve(r3, logn, a, na, b, nb, q3, isParallel); });
+    tasks.Wait();
+
+    // Garner's constants, in Montgomery form: 1/p1 modulo p2 and p3, and
+    // 1/p2 modulo p3; and p1 * p2 as two words.
+    WORD c12 = InvMont(ToMont(Reduce(q1.mP, q2), q2), q2);
+    WORD c13 = InvMont(ToMont(Reduce(q1.mP, q3), q3), q3);
+    WORD c23 = InvMont(ToMont(Reduce(q2.mP, q3), q3), q3);
+    DWORD p12 = (DWORD)q1.mP * q2.mP;
+    WORD p12lo = (WORD)p12;
+    WORD p12hi = (WORD)(p12 >> 64);
+
+    // Running sum of the coefficients, three words.
+    WORD s0 = 0;
+    WORD s1 = 0;
+    WORD s2 = 0;
+
+    for(int j=0; j<na+nb; ++j)
+    {
+        if(j < nc)
+        {
+            // x = x1 + x2*p1 + x3*p1*p2, each xi below pi. The primes
+            // are close enough that one subtraction reduces between them.
+            WORD x1 = r1[j];
+            WORD x2 = MulRedc(SubMod(r2[j], Reduce(x1, q2), q2), c12, q2);
+            WORD x3 = MulRedc(SubMod(r3[j], Reduce(x1, q3), q3), c13, q3);
+            x3 = MulRedc(SubMod(x3, Reduce(x2, q3), q3), c23, q3);
+
+            DWORD lo = (DWORD)x2 * q1.mP + x1;
+            DWORD m0 = (DWORD)x3 * p12lo;
+            DWORD m1 = (DWORD)x3 * p12hi + (WORD)(m0 >> 64);
+
+            // Add x = lo + m0 + m1 << 64 to the running sum.
+            DWORD c = (DWORD)s0 + (WORD)lo + (WORD)m0;
+            s0 = (WORD)c;
+            c = (c >> 64) + s1 + (WORD)(lo >> 64) + (WORD)m1;
+            s1 = (WORD)c;
+            s2 += (WORD)(c >> 64) + (WORD)(m1 >> 64);
+        }
+
+        // Write one digit and shift the sum down.
+        w[j] = (DIGIT)s0 & DIGIT_MASK;
+#ifdef MPIM_DIGIT64
+        s0 = s1;
+        s1 = s2;
+        s2 = 0;
+#else
+        s0 = (s0 >> SHIFT_VALUE) | (s1 << (64 - SHIFT_VALUE));
+        s1 = (s1 >> SHIFT_VALUE) | (s2 << (64 - SHIFT_VALUE));
+        s2 >>= SHIFT_VALUE;
+#endif
+    }
+}
@@ -0,0 +1,266 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "mpimpool.h"
+
+using namespace std;
+
+struct PoolTask
+{
+    function<void()> mFn;
+    atomic<int>* mPending;  // of the group the task belongs to
+};
+
+struct PoolQueue
+{
+    mutex mLock;
+    deque<PoolTask> mTasks;
+};
+
+// Queue 0 takes tasks from threads outside the pool; each pool thread has
+// one of its own.
+struct ThreadPool
+{
+    vector<thread> mThreads;
+    vector<PoolQueue> mQueues;
+    atomic<int> mQueued;         // tasks in all queues
+    mutex mSleepLock;
+    condition_variable mWake;
+    bool mIsStopping;
+
+    ThreadPool(int n);
+    ~ThreadPool();
+
+    void Push(PoolTask& t);
+    bool Pop(PoolTask& t);
+    void Work(int q);
+};
+
+static atomic<int> gThreadCount(0);     // 0 until set or first used
+static atomic<ThreadPool*> gPool(0);
+static mutex gPoolLock;                 // guards starting and stopping gPool
+
+static thread_local int tQueue = 0;
+
+/*****************************************************************************/
+// POOL
+/*****************************************************************************/
+
+ThreadPool::ThreadPool(int n) : mQueues(n)
+{
+    mQueued = 0;
+    mIsStopping = false;
+
+    for(int i=1; i<n; ++i)
+    {
+        mThreads.push_back(thread(&ThreadPool::Work, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(mSleepLock);
+        mIsStopping = true;
+    }
+    mWake.notify_all();
+
+    for(size_t i=0; i<mThreads.size(); ++i)
+    {
+        mThreads[i].join();
+    }
+}
+
+// Queue a task on this thread's own queue.
+void ThreadPool::Push(PoolTask& t)
+{
+    PoolQueue& q = mQueues[tQueue];
+    {
+        lock_guard<mutex> lock(q.mLock);
+        q.mTasks.push_back(move(t));
+    }
+    ++mQueued;
+
+    // Taking the lock orders this with a thread about to sleep.
+    {
+        lock_guard<mutex> lock(mSleepLock);
+    }
+    mWake.notify_one();
+}
+
+// Take the newest task of this thread, or else the oldest of another.
+bool ThreadPool::Pop(PoolTask& t)
+{
+    if(mQueued == 0)
+    {
+        return false;
+    }
+
+    int n = (int)mQueues.size();
+    for(int i=0; i<n; ++i)
+    {
+        PoolQueue& q = mQueues[(tQueue + i) % n];
+        lock_guard<mutex> lock(q.mLock);
+
+        if(!q.mTasks.empty())
+        {
+            if(i == 0)
+            {
+                t = move(q.mTasks.back());
+                q.mTasks.pop_back();
+            }
+            else
+            {
+                t = move(q.mTasks.front());
+                q.mTasks.pop_front();
+            }
+
+            --mQueued;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Body of pool thread q.
+void ThreadPool::Work(int q)
+{
+    tQueue = q;
+
+    for(;;)
+    {
+        PoolTask t;
+        if(Pop(t))
+        {
+            t.mFn();
+            --*t.mPending;
+            continue;
+        }
+
+        unique_lock<mutex> lock(mSleepLock);
+        mWake.wait(lock, [this] { return mIsStopping || mQueued > 0; });
+        if(mIsStopping && mQueued == 0)
+        {
+            return;
+        }
+    }
+}
+
+// Stops the pool when the program ends.
+static struct PoolOwner
+{
+    ~PoolOwner()
+    {
+        delete gPool.exchange(0);
+    }
+} gPoolOwner;
+
+// The pool, started if need be.
+static ThreadPool* Pool()
+{
+    ThreadPool* pool = gPool;
+    if(pool != 0)
+    {
+        return pool;
+    }
+
+    lock_guard<mutex> lock(gPoolLock);
+    if(gPool == 0)
+    {
+        gPool = new ThreadPool(GetThreadCount());
+    }
+
+    return gPool;
+}
+
+void SetThreadCount(int n)
+{
+    lock_guard<mutex> lock(gPoolLock);
+
+    delete gPool.exchange(0);
+    gThreadCount = (n < 1) ? 1 : n;
+}
+
+int GetThreadCount()
+{
+    if(gThreadCount == 0)
+    {
+        int n = (int)thread::hardware_concurrency();
+        gThreadCount = (n < 1) ? 1 : n;
+    }
+
+    return gThreadCount;
+}
+
+/*****************************************************************************/
+// TASK GROUPS
+/*****************************************************************************/
+
+TaskGroup::TaskGroup(bool isParallel)
+{
+    mIsParallel = isParallel && GetThreadCount() > 1;
+    mPending = 0;
+}
+
+TaskGroup::~TaskGroup()
+{
+    Wait();
+}
+
+void TaskGroup::Run(function<void()> fn)
+{
+    if(!mIsParallel)
+    {
+        fn();
+        return;
+    }
+
+    ++mPending;
+    PoolTask t = { move(fn), &mPending };
+    Pool()->Push(t);
+}
+
+void TaskGroup::Wait()
+{
+    if(!mIsParallel)
+    {
+        return;
+    }
+
+    ThreadPool* pool = Pool();
+    while(mPending > 0)
+    {
+        PoolTask t;
+        if(pool->Pop(t))
+        {
+            t.mFn();
+            --*t.mPending;
+        }
+        else
+        {
+            this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,85 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+Thread pool. Large multiplications split into independent smaller ones;
+those can run at the same time on the pool's threads:
+
+    TaskGroup tasks(n >= gThresholds.mMulThreaded);
+    tasks.Run([=] { DigitsMulN(w0, a, k, b, k); });
+    tasks.Run([=] { DigitsMulN(w1, ...); });
+    tasks.Wait();
+
+Each thread keeps its own queue of tasks, takes its newest task first, and
+when it has none steals the oldest task of another thread. A thread that
+waits for its group runs queued tasks meanwhile, so a task can start
+tasks of its own and wait for them without tying up a thread.
+
+The pool starts on first use with one thread per processor, counting the
+thread that waits. SetThreadCount changes that; with one thread, Run
+calls the function at once and nothing is started. The results do not
+depend on the number of threads, or on which thread ran which task.
+
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include <atomic>
+#include <functional>
+
+#ifndef MPIMPOOL_H
+#define MPIMPOOL_H
+
+// Threads used, counting the caller. Set it while no tasks are running.
+void SetThreadCount(int n);
+int GetThreadCount();
+
+// A set of tasks to wait for together.
+class TaskGroup
+{
+public:
+    // Tasks run on the pool only if isParallel, and there is more than
+    // one thread; otherwise Run calls them at once.
+    TaskGroup(bool isParallel = true);
+    ~TaskGroup();
+
+    void Run(std::function<void()> fn);
+    void Wait();  // Until every task run has finished.
+
+private:
+    TaskGroup(const TaskGroup&);
+    TaskGroup& operator=(const TaskGroup&);
+
+    bool mIsParallel;
+    std::atomic<int> mPending;  // tasks not yet finished
+};
+
+// Call f(lo, hi) on consecutive ranges that cover [begin, end), each of
+// at most grain, as tasks.
+template<class F>
+void ParallelFor(int begin, int end, int grain, F f, bool isParallel = true)
+{
+    TaskGroup tasks(isParallel);
+
+    for(int lo=begin; lo<end; lo+=grain)
+    {
+        int hi = (end-lo > grain) ? lo+grain : end;
+        tasks.Run([=] { f(lo, hi); });
+    }
+
+    tasks.Wait();
+}
+
+#endif
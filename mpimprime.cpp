@@ -0,0 +1,340 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpimprime.h"
+#include "mpimkern.h"
+#include "mpimpool.h"
+#include "mpimscr.h"
+#include <random>
+#include <string.h>
+
+#define PRIME_WINDOW 4096  // odd candidates sieved at a time
+
+/*****************************************************************************/
+// SMALL PRIMES
+/*****************************************************************************/
+
+// The primes below SMALL_PRIME_LIMIT by the sieve of Eratosthenes, and the
+// same primes in runs whose product fits a digit, made at compile time.
+struct SmallPrimeTable
+{
+    unsigned mPrime[SMALL_PRIMES];
+    MPIDivisor mGroup[SMALL_PRIMES];  // product of each run of primes
+    int mGroupEnd[SMALL_PRIMES];      // one past the last prime of the run
+    int mGroups;
+
+    constexpr SmallPrimeTable() : mPrime(), mGroup(), mGroupEnd(), mGroups(0)
+    {
+        bool isComposite[SMALL_PRIME_LIMIT] = {};
+        int n = 0;
+        for(int i=2; i<SMALL_PRIME_LIMIT; ++i)
+        {
+            if(!isComposite[i])
+            {
+                mPrime[n++] = i;
+                for(int j=i*i; j<SMALL_PRIME_LIMIT; j+=i)
+                {
+                    isComposite[j] = true;
+                }
+            }
+        }
+
+        DIGIT product = 1;
+        for(int i=0; i<SMALL_PRIMES; ++i)
+        {
+            if(product > DIGIT_MASK / mPrime[i])
+            {
+                mGroup[mGroups] = MPIDivisor(product);
+                mGroupEnd[mGroups++] = i;
+                product = 1;
+            }
+            product *= mPrime[i];
+        }
+        mGroup[mGroups] = MPIDivisor(product);
+        mGroupEnd[mGroups++] = SMALL_PRIMES;
+    }
+};
+
+static constexpr SmallPrimeTable gSmallPrimes;
+
+unsigned SmallPrime(int i)
+{
+    return gSmallPrimes.mPrime[i];
+}
+
+void DigitsSmallPrimeMod(unsigned* r, const DIGIT* a, int na)
+{
+    ScratchMark mark;
+    DIGIT* q = ScratchAlloc(na + 1);
+
+    int i = 0;
+    for(int g=0; g<gSmallPrimes.mGroups; ++g)
+    {
+        DIGIT rem = DigitsDivRem1(q, a, na, gSmallPrimes.mGroup[g]);
+        for(; i<gSmallPrimes.mGroupEnd[g]; ++i)
+        {
+            r[i] = (unsigned)(rem % gSmallPrimes.mPrime[i]);
+        }
+    }
+}
+
+/*****************************************************************************/
+// MILLER-RABIN
+/*****************************************************************************/
+
+// A random value below 2^bits.
+static MPI RandomBits(int bits, std::mt19937_64& g)
+{
+    MPI x;
+    int n = (bits + SHIFT_VALUE - 1) / SHIFT_VALUE;
+    x.Reserve(n);
+    for(int i=0; i<n; ++i)
+    {
+        x.mArray[i] = (DIGIT)g() & DIGIT_MASK;
+    }
+    if(bits % SHIFT_VALUE != 0)
+    {
+        x.mArray[n-1] &= ((DIGIT)1 << (bits % SHIFT_VALUE)) - 1;
+    }
+    x.mSize = n;
+    x.Normalize();
+
+    return x;
+}
+
+// The bases are random, so one generator for each thread of the pool.
+static std::mt19937_64& BaseGenerator()
+{
+    thread_local std::mt19937_64 g(std::random_device{}());
+    return g;
+}
+
+// Miller-Rabin test of an odd n > 4: with n - 1 = d 2^s, d odd, a prime n
+// has a^d = 1 or a^(d 2^j) = -1 mod n for some j < s, for any base a. The
+// first base is 2 and the rest random; a composite passes each with
+// chance at most 1/4. The squarings stay in the Montgomery domain.
+// Algorithm based on Menezes, 4.24, p. 139.
+static bool MillerRabin(const MPI& n, int rounds)
+{
+    MPIModulus m(n);
+    MPI n1 = n - 1;
+    int s = 0;
+    while(!n1.Bit(s))
+    {
+        ++s;
+    }
+    MPI d = n1;
+    d.ShiftRightBits(s);
+
+    MPI one = 1;
+    MPI range = n - 3;
+    MPI oneMont;
+    MPI minusOneMont;
+    for(int i=0; i<rounds; ++i)
+    {
+        MPI a = 2;
+        if(i > 0)
+        {
+            a = RandomBits(range.Bits() + SHIFT_VALUE, BaseGenerator()) % range + 2;
+        }
+
+        MPI y = a.MontPow(d, m);
+        if(y == one || y == n1)
+        {
+            continue;
+        }
+
+        if(oneMont.Size() == 0)
+        {
+            oneMont = m.ToMont(one);
+            minusOneMont = m.ToMont(n1);
+        }
+
+        y = m.ToMont(y);
+        int j = 1;
+        for(; j<s; ++j)
+        {
+            y = m.MontMult(y, y);
+            if(y == minusOneMont)
+            {
+                break;
+            }
+            if(y == oneMont)
+            {
+                return false;
+            }
+        }
+        if(j == s)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*****************************************************************************/
+// PRIME SEARCH
+/*****************************************************************************/
+
+// The first probable prime at or above x. A window of odd candidates
+// x + 2 j is sieved by the small primes, and those left are tested in
+// order, one for each thread at a time.
+static MPI SearchPrime(MPI x, int rounds)
+{
+    unsigned last = SmallPrime(SMALL_PRIMES-1);
+    if(x.mSize <= 1 && x.Digit(0) <= last)
+    {
+        int i = 0;
+        while(SmallPrime(i) < x.Digit(0))
+        {
+            ++i;
+        }
+        return MPI((int)SmallPrime(i));
+    }
+
+    if(!x.Bit(0))
+    {
+        ++x;
+    }
+
+    int threads = GetThreadCount();
+    unsigned r[SMALL_PRIMES];
+    bool isComposite[PRIME_WINDOW];
+    bool isPrime[PRIME_WINDOW];
+    int left[PRIME_WINDOW];
+    for(;;)
+    {
+        // x + 2 j is a multiple of p when j = -x / 2 mod p.
+        DigitsSmallPrimeMod(r, x.mArray, x.mSize);
+        memset(isComposite, 0, sizeof(isComposite));
+        for(int i=1; i<SMALL_PRIMES; ++i)
+        {
+            unsigned p = SmallPrime(i);
+            unsigned j = (p - r[i]) % p * ((p + 1) / 2) % p;
+            for(; j<PRIME_WINDOW; j+=p)
+            {
+                isComposite[j] = true;
+            }
+        }
+
+        int n = 0;
+        for(int j=0; j<PRIME_WINDOW; ++j)
+        {
+            if(!isComposite[j])
+            {
+                left[n++] = j;
+            }
+        }
+
+        for(int i=0; i<n; i+=threads)
+        {
+            int end = (i + threads < n) ? i + threads : n;
+            ParallelFor(i, end, 1, [&](int lo, int hi)
+            {
+                for(int k=lo; k<hi; ++k)
+                {
+                    isPrime[k] = MillerRabin(x + 2 * left[k], rounds);
+                }
+            });
+
+            for(int k=i; k<end; ++k)
+            {
+                if(isPrime[k])
+                {
+                    return x + 2 * left[k];
+                }
+            }
+        }
+
+        x += 2 * PRIME_WINDOW;
+    }
+}
+
+/*****************************************************************************/
+// PRIME FUNCTIONS
+/*****************************************************************************/
+
+// True if this is prime, or a composite that passed every round, which
+// happens with chance at most 4^-rounds.
+bool MPI::IsProbablePrime(int rounds) const
+{
+    if(mSize <= 1 && Digit(0) < SMALL_PRIME_LIMIT)
+    {
+        for(int i=0; i<SMALL_PRIMES; ++i)
+        {
+            if(SmallPrime(i) == Digit(0))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    unsigned r[SMALL_PRIMES];
+    DigitsSmallPrimeMod(r, mArray, mSize);
+    for(int i=0; i<SMALL_PRIMES; ++i)
+    {
+        if(r[i] == 0)
+        {
+            return false;
+        }
+    }
+
+    // With no factor below the limit, anything below its square is prime.
+    if(mSize == 1 && Digit(0) < (DIGIT)SMALL_PRIME_LIMIT * SMALL_PRIME_LIMIT)
+    {
+        return true;
+    }
+
+    return MillerRabin(*this, rounds);
+}
+
+// The smallest probable prime above this.
+MPI MPI::NextPrime(int rounds) const
+{
+    return SearchPrime(*this + 1, rounds);
+}
+
+// A random probable prime of exactly the given bits, the first found from
+// a random start. Overflow if bits < 2.
+MPI MPI::RandomPrime(int bits, int rounds)
+{
+    MPI w;
+    if(bits < 2)
+    {
+        w.mIsOverflow = true;
+        return w;
+    }
+
+    std::random_device device;
+    std::seed_seq seed{device(), device(), device(), device(),
+                       device(), device(), device(), device()};
+    std::mt19937_64 g(seed);
+
+    MPI top = 1;
+    top.ShiftLeftBits(bits - 1);
+    do
+    {
+        w = SearchPrime(RandomBits(bits - 1, g) + top, rounds);
+    }
+    while(w.Bits() != bits);
+
+    return w;
+}
@@ -0,0 +1,46 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+Primes, see MPI::IsProbablePrime, MPI::NextPrime and MPI::RandomPrime.
+A candidate is first divided by the primes below SMALL_PRIME_LIMIT, which
+rejects most composites for the cost of a few single digit divisions: the
+primes are kept in groups whose product fits a digit, so each group needs
+one pass of DigitsDivRem1 over the candidate. Those left get rounds of the
+Miller-Rabin test, each a modular exponential by the Montgomery method.
+
+A search sieves a window of odd candidates by the same small primes, from
+one set of remainders of the start of the window, and then tests those
+left a batch at a time on the thread pool, taking the first prime found.
+
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpim.h"
+
+#ifndef MPIMPRIME_H
+#define MPIMPRIME_H
+
+#define SMALL_PRIME_LIMIT  2000  // trial division by the primes below this
+#define SMALL_PRIMES       303   // number of primes below SMALL_PRIME_LIMIT
+
+// The i'th prime, counting 2 as the 0'th, for i < SMALL_PRIMES.
+unsigned SmallPrime(int i);
+
+// r[i] = a mod SmallPrime(i), for every i < SMALL_PRIMES.
+void DigitsSmallPrimeMod(unsigned* r, const DIGIT* a, int na);
+
+#endif
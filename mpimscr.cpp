@@ -0,0 +1,206 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpimscr.h"
+
+// Most blocks an arena holds. Each new block at least doubles the total,
+// so this is never reached in practice.
+#define MAX_BLOCKS 40
+
+// Smallest block allocated, in digits.
+#define MIN_BLOCK 1024
+
+// Per-thread arena. Blocks are used in order, and blocks past the current
+// one are kept for reuse.
+struct ScratchArena
+{
+    DIGIT* mBlock[MAX_BLOCKS];  // digit blocks
+    long long mSize[MAX_BLOCKS];// digits in each block
+    int mCount;                 // blocks allocated
+    int mCurr;                  // block in use, -1 before the first
+    long long mUsed;            // digits used in the current block
+    long long mInUse;           // digits used in all blocks
+    int mDepth;                 // active ScratchMarks
+    MPIAllocStats mStats;
+
+    ScratchArena()
+    {
+        mCount = 0;
+        mCurr = -1;
+        mUsed = 0;
+        mInUse = 0;
+        mDepth = 0;
+        mStats = MPIAllocStats();
+    }
+
+    ~ScratchArena()
+    {
+        Free(0);
+    }
+
+    // Free blocks from index k up.
+    void Free(int k)
+    {
+        for(int i=k; i<mCount; ++i)
+        {
+            mStats.mScratchSize -= mSize[i];
+            delete[] mBlock[i];
+        }
+
+        mCount = k;
+    }
+
+    // Replace all blocks by a single one large enough for all of them,
+    // so the next computation of the same size needs only one block.
+    void Merge()
+    {
+        long long total = 0;
+        for(int i=0; i<mCount; ++i)
+        {
+            total += mSize[i];
+        }
+
+        Free(0);
+        Grow(total);
+        mCurr = -1;
+        mUsed = 0;
+    }
+
+    // Add a block of at least n digits after the current one.
+    void Grow(long long n)
+    {
+        long long k = mStats.mScratchSize;
+        if(k < n)
+        {
+            k = n;
+        }
+        if(k < MIN_BLOCK)
+        {
+            k = MIN_BLOCK;
+        }
+
+        mBlock[mCount] = new DIGIT[k];
+        mSize[mCount] = k;
+        ++mCount;
+        ++mStats.mScratchGrows;
+        mStats.mScratchSize += k;
+    }
+};
+
+static thread_local ScratchArena gArena;
+
+/*****************************************************************************/
+// ALLOCATION
+/*****************************************************************************/
+
+// Bump allocate from the current block, moving to the next block when it
+// is full.
+DIGIT* ScratchAlloc(int n)
+{
+    ScratchArena& a = gArena;
+
+    ++a.mStats.mScratchAllocs;
+
+    if(a.mCurr < 0 || a.mUsed + n > a.mSize[a.mCurr])
+    {
+        // Digits left at the end of this block are wasted until release.
+        if(a.mCurr >= 0)
+        {
+            a.mInUse += a.mSize[a.mCurr] - a.mUsed;
+        }
+
+        int k = a.mCurr + 1;
+        if(k >= a.mCount || a.mSize[k] < n)
+        {
+            a.Free(k);
+            a.Grow(n);
+        }
+
+        a.mCurr = k;
+        a.mUsed = 0;
+    }
+
+    DIGIT* p = a.mBlock[a.mCurr] + a.mUsed;
+    a.mUsed += n;
+    a.mInUse += n;
+
+    if(a.mStats.mScratchPeak < a.mInUse)
+    {
+        a.mStats.mScratchPeak = a.mInUse;
+    }
+
+    return p;
+}
+
+ScratchMark::ScratchMark()
+{
+    ScratchArena& a = gArena;
+
+    mBlock = a.mCurr;
+    mUsed = a.mUsed;
+    mInUse = a.mInUse;
+    ++a.mDepth;
+}
+
+ScratchMark::~ScratchMark()
+{
+    ScratchArena& a = gArena;
+
+    // Everything allocated since the mark is released together.
+    a.mCurr = mBlock;
+    a.mUsed = mUsed;
+    a.mInUse = mInUse;
+
+    if(--a.mDepth == 0 && a.mCount > 1)
+    {
+        a.Merge();
+    }
+}
+
+void ScratchFree()
+{
+    gArena.Free(0);
+    gArena.mCurr = -1;
+    gArena.mUsed = 0;
+    gArena.mInUse = 0;
+}
+
+/*****************************************************************************/
+// COUNTERS
+/*****************************************************************************/
+
+MPIAllocStats GetAllocStats()
+{
+    return gArena.mStats;
+}
+
+// The arena size is kept, since the memory is still held.
+void ResetAllocStats()
+{
+    long long size = gArena.mStats.mScratchSize;
+
+    gArena.mStats = MPIAllocStats();
+    gArena.mStats.mScratchSize = size;
+    gArena.mStats.mScratchPeak = gArena.mInUse;
+}
+
+void CountHeapAlloc()
+{
+    ++gArena.mStats.mHeapAllocs;
+}
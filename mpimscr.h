@@ -0,0 +1,87 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+Scratch arena. Multiplication and division need temporary digit vectors at
+every level of their recursion. Rather than building MPI objects for them,
+they take digits from a per-thread arena with a bump allocator, and give
+them back in bulk when a ScratchMark goes out of scope:
+
+    ScratchMark mark;
+    DIGIT* t = ScratchAlloc(n);
+    ...
+    // t is released here.
+
+The arena keeps its memory between calls. Once it has grown to the largest
+size a computation needs, further calls draw no heap memory at all, and the
+digits handed out are not cleared.
+
+The counters in MPIAllocStats are kept per thread, so a caller can measure
+exactly the allocations made by its own operations.
+
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpim.h"
+
+#ifndef MPIMSCR_H
+#define MPIMSCR_H
+
+// Allocation counters for the calling thread.
+struct MPIAllocStats
+{
+    unsigned long long mHeapAllocs;     // MPI digit buffers allocated
+    unsigned long long mScratchAllocs;  // ScratchAlloc calls
+    unsigned long long mScratchGrows;   // arena blocks allocated
+    long long mScratchPeak;             // most scratch digits in use at once
+    long long mScratchSize;             // scratch digits currently held
+};
+
+// Get n uninitialized digits from the calling thread's arena.
+// Must be called with a ScratchMark active, and the digits stay valid
+// until the innermost one is released.
+DIGIT* ScratchAlloc(int n);
+
+// Remembers the arena position, and releases everything allocated after
+// it when destroyed.
+class ScratchMark
+{
+public:
+    ScratchMark();
+    ~ScratchMark();
+
+private:
+    ScratchMark(const ScratchMark&);
+    ScratchMark& operator=(const ScratchMark&);
+
+    int mBlock;      // arena block in use
+    long long mUsed; // digits used in that block
+    long long mInUse;// digits used in all blocks
+};
+
+// Free the calling thread's arena memory. No ScratchMark may be active.
+void ScratchFree();
+
+// Read the calling thread's counters.
+MPIAllocStats GetAllocStats();
+
+// Clear them, keeping the arena size.
+void ResetAllocStats();
+
+// Count an MPI digit buffer allocation, called by MPI::Reserve.
+void CountHeapAlloc();
+
+#endif
@@ -0,0 +1,535 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpimkern.h"
+#include "mpimsimd.h"
+
+#ifdef MPIM_SIMD
+
+#include <immintrin.h>
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+
+// Carries into each of n lanes, given the lanes that generate a carry, g,
+// the lanes that pass one on, p, and the carry into the lowest lane.
+// No lane is in both, so adding g to g|p carries exactly as the digits
+// would; the sum bits, less p, are the carries in, and the bit above the
+// lanes is the carry out.
+static inline unsigned LaneCarries(unsigned g, unsigned p, unsigned cin, int n, unsigned* cout)
+{
+    unsigned t = g + (g | p) + cin;
+
+    *cout = t >> n;
+    return (t ^ p) & ((1u << n) - 1);
+}
+
+/*****************************************************************************/
+// AVX2, FOUR DIGITS AT A TIME
+/*****************************************************************************/
+
+TARGET_AVX2 static inline __m256i Load4(const DIGIT* p)
+{
+    return _mm256_loadu_si256((const __m256i*)p);
+}
+
+TARGET_AVX2 static inline void Store4(DIGIT* p, __m256i v)
+{
+    _mm256_storeu_si256((__m256i*)p, v);
+}
+
+// One bit per lane, from the top bit of each.
+TARGET_AVX2 static inline unsigned Bits4(__m256i v)
+{
+    return (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(v));
+}
+
+// All ones in the lanes whose bit is set in c.
+TARGET_AVX2 static inline __m256i Lanes4(unsigned c)
+{
+    const __m256i bit = _mm256_set_epi64x(8, 4, 2, 1);
+
+    return _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(c), bit), bit);
+}
+
+// All ones in the lanes below n.
+TARGET_AVX2 static inline __m256i Below4(int n)
+{
+    return _mm256_cmpgt_epi64(_mm256_set1_epi64x(n), _mm256_set_epi64x(3, 2, 1, 0));
+}
+
+TARGET_AVX2 static DIGIT DigitsAddAvx2(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    const __m256i m = _mm256_set1_epi64x((long long)DIGIT_MASK);
+#ifdef MPIM_DIGIT64
+    const __m256i sign = _mm256_set1_epi64x((long long)0x8000000000000000ULL);
+#endif
+    unsigned carry = 0;
+    int i = 0;
+
+    for(; i+4<=nb; i+=4)
+    {
+        __m256i x = Load4(a+i);
+        __m256i s = _mm256_add_epi64(x, Load4(b+i));
+
+        // A lane generates a carry if it wrapped, and passes one on if
+        // it is all ones.
+#ifdef MPIM_DIGIT64
+        unsigned g = Bits4(_mm256_cmpgt_epi64(_mm256_xor_si256(x, sign),
+                                              _mm256_xor_si256(s, sign)));
+#else
+        unsigned g = Bits4(_mm256_cmpgt_epi64(s, m));
+        s = _mm256_and_si256(s, m);
+#endif
+        unsigned p = Bits4(_mm256_cmpeq_epi64(s, m));
+        unsigned c = LaneCarries(g, p, carry, 4, &carry);
+
+        s = _mm256_sub_epi64(s, Lanes4(c));
+#ifndef MPIM_DIGIT64
+        s = _mm256_and_si256(s, m);
+#endif
+        Store4(w+i, s);
+    }
+
+    for(; i<nb; ++i)
+    {
+        DDIGIT s = (DDIGIT)a[i] + b[i] + carry;
+        w[i] = (DIGIT)(s & DIGIT_MASK);
+        carry = (unsigned)(s >> SHIFT_VALUE);
+    }
+
+    return DigitsAdd1(w+i, a+i, na-i, carry);
+}
+
+TARGET_AVX2 static DIGIT DigitsSubAvx2(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    const __m256i zero = _mm256_setzero_si256();
+#ifdef MPIM_DIGIT64
+    const __m256i sign = _mm256_set1_epi64x((long long)0x8000000000000000ULL);
+#else
+    const __m256i m = _mm256_set1_epi64x((long long)DIGIT_MASK);
+#endif
+    unsigned borrow = 0;
+    int i = 0;
+
+    for(; i+4<=nb; i+=4)
+    {
+        __m256i x = Load4(a+i);
+        __m256i y = Load4(b+i);
+        __m256i d = _mm256_sub_epi64(x, y);
+
+        // A lane generates a borrow if it wrapped, and passes one on if
+        // it is zero.
+#ifdef MPIM_DIGIT64
+        unsigned g = Bits4(_mm256_cmpgt_epi64(_mm256_xor_si256(y, sign),
+                                              _mm256_xor_si256(x, sign)));
+#else
+        unsigned g = Bits4(_mm256_cmpgt_epi64(y, x));
+        d = _mm256_and_si256(d, m);
+#endif
+        unsigned p = Bits4(_mm256_cmpeq_epi64(d, zero));
+        unsigned c = LaneCarries(g, p, borrow, 4, &borrow);
+
+        d = _mm256_add_epi64(d, Lanes4(c));
+#ifndef MPIM_DIGIT64
+        d = _mm256_and_si256(d, m);
+#endif
+        Store4(w+i, d);
+    }
+
+    for(; i<nb; ++i)
+    {
+        DDIGIT s = (DDIGIT)a[i] - b[i] - borrow;
+        w[i] = (DIGIT)(s & DIGIT_MASK);
+        borrow = (unsigned)(s >> SHIFT_VALUE) & 1;
+    }
+
+    return DigitsSub1(w+i, a+i, na-i, borrow);
+}
+
+TARGET_AVX2 static DIGIT DigitsShlAvx2(DIGIT* w, const DIGIT* a, int na, int bits)
+{
+    const __m128i up = _mm_cvtsi32_si128(bits);
+    const __m128i down = _mm_cvtsi32_si128(SHIFT_VALUE - bits);
+#ifndef MPIM_DIGIT64
+    const __m256i m = _mm256_set1_epi64x((long long)DIGIT_MASK);
+#endif
+    DIGIT out = a[na-1] >> (SHIFT_VALUE - bits);
+    int i = na-1;
+
+    // Work from the top down so w may overlap a; each block is read in
+    // full before it is written.
+    for(; i>=4; i-=4)
+    {
+        __m256i hi = _mm256_sll_epi64(Load4(a+i-3), up);
+        __m256i lo = _mm256_srl_epi64(Load4(a+i-4), down);
+#ifndef MPIM_DIGIT64
+        hi = _mm256_and_si256(hi, m);
+#endif
+        Store4(w+i-3, _mm256_or_si256(hi, lo));
+    }
+
+    for(; i>0; --i)
+    {
+        w[i] = ((a[i] << bits) & DIGIT_MASK) | (a[i-1] >> (SHIFT_VALUE - bits));
+    }
+    w[0] = (a[0] << bits) & DIGIT_MASK;
+
+    return out;
+}
+
+TARGET_AVX2 static DIGIT DigitsShrAvx2(DIGIT* w, const DIGIT* a, int na, int bits)
+{
+    const __m128i down = _mm_cvtsi32_si128(bits);
+    const __m128i up = _mm_cvtsi32_si128(SHIFT_VALUE - bits);
+#ifndef MPIM_DIGIT64
+    const __m256i m = _mm256_set1_epi64x((long long)DIGIT_MASK);
+#endif
+    DIGIT out = (a[0] << (SHIFT_VALUE - bits)) & DIGIT_MASK;
+    int i = 0;
+
+    // Work from the bottom up so w may overlap a.
+    for(; i+4<na; i+=4)
+    {
+        __m256i lo = _mm256_srl_epi64(Load4(a+i), down);
+        __m256i hi = _mm256_sll_epi64(Load4(a+i+1), up);
+#ifndef MPIM_DIGIT64
+        hi = _mm256_and_si256(hi, m);
+#endif
+        Store4(w+i, _mm256_or_si256(hi, lo));
+    }
+
+    for(; i<na-1; ++i)
+    {
+        w[i] = (a[i] >> bits) | ((a[i+1] << (SHIFT_VALUE - bits)) & DIGIT_MASK);
+    }
+    w[na-1] = a[na-1] >> bits;
+
+    return out;
+}
+
+#ifndef MPIM_DIGIT64
+
+// Schoolbook product, carry-save. With 30-bit digits each lane holds a
+// whole product; each row adds the low halves of its products at their
+// own digit and the high halves one digit up, without carrying. A digit
+// gains less than 2B per row, so a 64-bit lane holds the sums, and one
+// pass at the end carries them.
+TARGET_AVX2 static void DigitsMulAvx2(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    const __m256i m = _mm256_set1_epi64x(DIGIT_MASK);
+
+    for(int i=0; i<na+nb; ++i)
+    {
+        w[i] = 0;
+    }
+
+    for(int j=0; j<nb; ++j)
+    {
+        const __m256i bv = _mm256_set1_epi64x(b[j]);
+        DIGIT* r = w + j;
+        __m256i prev = _mm256_setzero_si256();
+
+        // The row covers na+1 digits.
+        for(int i=0; i<=na; i+=4)
+        {
+            __m256i x = (i+4 <= na) ? Load4(a+i)
+                : _mm256_maskload_epi64((const long long*)(a+i), Below4(na-i));
+            __m256i p = _mm256_mul_epu32(x, bv);
+            __m256i hi = _mm256_permute4x64_epi64(_mm256_srli_epi64(p, SHIFT_VALUE), 0x93);
+            __m256i v = _mm256_add_epi64(_mm256_and_si256(p, m),
+                                         _mm256_blend_epi32(hi, prev, 0x03));
+            prev = hi;
+
+            if(i+4 <= na+1)
+            {
+                Store4(r+i, _mm256_add_epi64(Load4(r+i), v));
+            }
+            else
+            {
+                __m256i k = Below4(na+1-i);
+                __m256i y = _mm256_maskload_epi64((const long long*)(r+i), k);
+                _mm256_maskstore_epi64((long long*)(r+i), k, _mm256_add_epi64(y, v));
+            }
+        }
+    }
+
+    DIGIT carry = 0;
+    for(int i=0; i<na+nb; ++i)
+    {
+        DIGIT t = w[i] + carry;
+        w[i] = t & DIGIT_MASK;
+        carry = t >> SHIFT_VALUE;
+    }
+}
+
+#endif
+
+/*****************************************************************************/
+// AVX-512, EIGHT DIGITS AT A TIME
+/*****************************************************************************/
+
+TARGET_AVX512 static inline __m512i Load8(const DIGIT* p)
+{
+    return _mm512_loadu_si512((const void*)p);
+}
+
+TARGET_AVX512 static inline void Store8(DIGIT* p, __m512i v)
+{
+    _mm512_storeu_si512((void*)p, v);
+}
+
+// Each lane shifted by the count in n. The plain intrinsics set off a
+// false -Wmaybe-uninitialized in some GCC headers; the masked ones do not.
+TARGET_AVX512 static inline __m512i Shl8(__m512i v, __m512i n)
+{
+    return _mm512_maskz_sllv_epi64((__mmask8)0xFF, v, n);
+}
+
+TARGET_AVX512 static inline __m512i Shr8(__m512i v, __m512i n)
+{
+    return _mm512_maskz_srlv_epi64((__mmask8)0xFF, v, n);
+}
+
+// Mask of the lanes below n.
+static inline __mmask8 Below8(int n)
+{
+    return (__mmask8)((n >= 8) ? 0xFF : (1u << n) - 1);
+}
+
+TARGET_AVX512 static DIGIT DigitsAddAvx512(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    const __m512i m = _mm512_set1_epi64((long long)DIGIT_MASK);
+    const __m512i one = _mm512_set1_epi64(1);
+    unsigned carry = 0;
+    int i = 0;
+
+    for(; i+8<=nb; i+=8)
+    {
+        __m512i x = Load8(a+i);
+        __m512i s = _mm512_add_epi64(x, Load8(b+i));
+
+#ifdef MPIM_DIGIT64
+        unsigned g = _mm512_cmplt_epu64_mask(s, x);
+#else
+        unsigned g = _mm512_cmpgt_epu64_mask(s, m);
+        s = _mm512_and_si512(s, m);
+#endif
+        unsigned p = _mm512_cmpeq_epi64_mask(s, m);
+        unsigned c = LaneCarries(g, p, carry, 8, &carry);
+
+        s = _mm512_mask_add_epi64(s, (__mmask8)c, s, one);
+#ifndef MPIM_DIGIT64
+        s = _mm512_and_si512(s, m);
+#endif
+        Store8(w+i, s);
+    }
+
+    for(; i<nb; ++i)
+    {
+        DDIGIT s = (DDIGIT)a[i] + b[i] + carry;
+        w[i] = (DIGIT)(s & DIGIT_MASK);
+        carry = (unsigned)(s >> SHIFT_VALUE);
+    }
+
+    return DigitsAdd1(w+i, a+i, na-i, carry);
+}
+
+TARGET_AVX512 static DIGIT DigitsSubAvx512(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i one = _mm512_set1_epi64(1);
+#ifndef MPIM_DIGIT64
+    const __m512i m = _mm512_set1_epi64((long long)DIGIT_MASK);
+#endif
+    unsigned borrow = 0;
+    int i = 0;
+
+    for(; i+8<=nb; i+=8)
+    {
+        __m512i x = Load8(a+i);
+        __m512i y = Load8(b+i);
+        __m512i d = _mm512_sub_epi64(x, y);
+
+        unsigned g = _mm512_cmplt_epu64_mask(x, y);
+#ifndef MPIM_DIGIT64
+        d = _mm512_and_si512(d, m);
+#endif
+        unsigned p = _mm512_cmpeq_epi64_mask(d, zero);
+        unsigned c = LaneCarries(g, p, borrow, 8, &borrow);
+
+        d = _mm512_mask_sub_epi64(d, (__mmask8)c, d, one);
+#ifndef MPIM_DIGIT64
+        d = _mm512_and_si512(d, m);
+#endif
+        Store8(w+i, d);
+    }
+
+    for(; i<nb; ++i)
+    {
+        DDIGIT s = (DDIGIT)a[i] - b[i] - borrow;
+        w[i] = (DIGIT)(s & DIGIT_MASK);
+        borrow = (unsigned)(s >> SHIFT_VALUE) & 1;
+    }
+
+    return DigitsSub1(w+i, a+i, na-i, borrow);
+}
+
+TARGET_AVX512 static DIGIT DigitsShlAvx512(DIGIT* w, const DIGIT* a, int na, int bits)
+{
+    const __m512i up = _mm512_set1_epi64(bits);
+    const __m512i down = _mm512_set1_epi64(SHIFT_VALUE - bits);
+#ifndef MPIM_DIGIT64
+    const __m512i m = _mm512_set1_epi64((long long)DIGIT_MASK);
+#endif
+    DIGIT out = a[na-1] >> (SHIFT_VALUE - bits);
+    int i = na-1;
+
+    // Work from the top down so w may overlap a; each block is read in
+    // full before it is written.
+    for(; i>=8; i-=8)
+    {
+        __m512i hi = Shl8(Load8(a+i-7), up);
+        __m512i lo = Shr8(Load8(a+i-8), down);
+#ifndef MPIM_DIGIT64
+        hi = _mm512_and_si512(hi, m);
+#endif
+        Store8(w+i-7, _mm512_or_si512(hi, lo));
+    }
+
+    for(; i>0; --i)
+    {
+        w[i] = ((a[i] << bits) & DIGIT_MASK) | (a[i-1] >> (SHIFT_VALUE - bits));
+    }
+    w[0] = (a[0] << bits) & DIGIT_MASK;
+
+    return out;
+}
+
+TARGET_AVX512 static DIGIT DigitsShrAvx512(DIGIT* w, const DIGIT* a, int na, int bits)
+{
+    const __m512i down = _mm512_set1_epi64(bits);
+    const __m512i up = _mm512_set1_epi64(SHIFT_VALUE - bits);
+#ifndef MPIM_DIGIT64
+    const __m512i m = _mm512_set1_epi64((long long)DIGIT_MASK);
+#endif
+    DIGIT out = (a[0] << (SHIFT_VALUE - bits)) & DIGIT_MASK;
+    int i = 0;
+
+    // Work from the bottom up so w may overlap a.
+    for(; i+8<na; i+=8)
+    {
+        __m512i lo = Shr8(Load8(a+i), down);
+        __m512i hi = Shl8(Load8(a+i+1), up);
+#ifndef MPIM_DIGIT64
+        hi = _mm512_and_si512(hi, m);
+#endif
+        Store8(w+i, _mm512_or_si512(hi, lo));
+    }
+
+    for(; i<na-1; ++i)
+    {
+        w[i] = (a[i] >> bits) | ((a[i+1] << (SHIFT_VALUE - bits)) & DIGIT_MASK);
+    }
+    w[na-1] = a[na-1] >> bits;
+
+    return out;
+}
+
+#ifndef MPIM_DIGIT64
+
+// As DigitsMulAvx2.
+TARGET_AVX512 static void DigitsMulAvx512(DIGIT* w, const DIGIT* a, int na, const DIGIT* b, int nb)
+{
+    const __m512i m = _mm512_set1_epi64(DIGIT_MASK);
+
+    for(int i=0; i<na+nb; ++i)
+    {
+        w[i] = 0;
+    }
+
+    for(int j=0; j<nb; ++j)
+    {
+        const __m512i bv = _mm512_set1_epi64(b[j]);
+        DIGIT* r = w + j;
+        __m512i prev = _mm512_setzero_si512();
+
+        // The row covers na+1 digits.
+        for(int i=0; i<=na; i+=8)
+        {
+            __m512i x = (i+8 <= na) ? Load8(a+i) : _mm512_maskz_loadu_epi64(Below8(na-i), a+i);
+            // The zero-masked forms, as g++ 12 warns the plain ones may read
+            // an uninitialized pass-through.
+            __m512i p = _mm512_maskz_mul_epu32(0xFF, x, bv);
+            __m512i hi = _mm512_maskz_srli_epi64(0xFF, p, SHIFT_VALUE);
+            __m512i v = _mm512_add_epi64(_mm512_and_si512(p, m),
+                                         _mm512_maskz_alignr_epi64(0xFF, hi, prev, 7));
+            prev = hi;
+
+            if(i+8 <= na+1)
+            {
+                Store8(r+i, _mm512_add_epi64(Load8(r+i), v));
+            }
+            else
+            {
+                __mmask8 k = Below8(na+1-i);
+                __m512i y = _mm512_maskz_loadu_epi64(k, r+i);
+                _mm512_mask_storeu_epi64(r+i, k, _mm512_add_epi64(y, v));
+            }
+        }
+    }
+
+    DIGIT carry = 0;
+    for(int i=0; i<na+nb; ++i)
+    {
+        DIGIT t = w[i] + carry;
+        w[i] = t & DIGIT_MASK;
+        carry = t >> SHIFT_VALUE;
+    }
+}
+
+#endif
+
+/*****************************************************************************/
+// TABLES
+/*****************************************************************************/
+
+void KernelsAvx2(MPIKernels* k)
+{
+    k->mAdd = DigitsAddAvx2;
+    k->mSub = DigitsSubAvx2;
+    k->mShl = DigitsShlAvx2;
+    k->mShr = DigitsShrAvx2;
+#ifndef MPIM_DIGIT64
+    k->mMul = DigitsMulAvx2;
+#endif
+}
+
+void KernelsAvx512(MPIKernels* k)
+{
+    k->mAdd = DigitsAddAvx512;
+    k->mSub = DigitsSubAvx512;
+    k->mShl = DigitsShlAvx512;
+    k->mShr = DigitsShrAvx512;
+#ifndef MPIM_DIGIT64
+    k->mMul = DigitsMulAvx512;
+#endif
+}
+
+#endif
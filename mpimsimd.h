@@ -0,0 +1,63 @@
+/******************************************************************************
+MPIM - Multi Precision Integer Math
+Copyright (C) 1997-2020 Norm Moulton
+
+Vector versions of the digit kernels. mpimkern.cpp calls the kernels
+through a table, which starts out pointing at the portable code and is
+filled in at startup with the widest versions the processor supports, as
+reported by CPUID. The vector code is compiled with target attributes, so
+no special compiler flags are needed, and a processor without the
+instructions never runs it.
+
+Adding, subtracting and shifting are vectorized for both digit sizes;
+the carries between lanes are resolved with a mask, as in a carry
+lookahead adder. With 30-bit digits a product of two digits fits in a
+64-bit lane, so the schoolbook product is vectorized as well, summed
+carry-save and normalized once at the end. A single row, as in
+DigitsMul1, gains nothing that way: its carries are a chain either way.
+
+Define MPIM_NO_SIMD to build without them.
+
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "mpim.h"
+
+#ifndef MPIMSIMD_H
+#define MPIMSIMD_H
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(MPIM_NO_SIMD)
+#define MPIM_SIMD
+#endif
+
+// The kernels that have vector versions, with the same contracts as the
+// functions of the same name in mpimkern.h.
+struct MPIKernels
+{
+    DIGIT (*mAdd)(DIGIT*, const DIGIT*, int, const DIGIT*, int);
+    DIGIT (*mSub)(DIGIT*, const DIGIT*, int, const DIGIT*, int);
+    void (*mMul)(DIGIT*, const DIGIT*, int, const DIGIT*, int);
+    DIGIT (*mShl)(DIGIT*, const DIGIT*, int, int);  // na >= 1, bits > 0
+    DIGIT (*mShr)(DIGIT*, const DIGIT*, int, int);  // na >= 1, bits > 0
+};
+
+#ifdef MPIM_SIMD
+// Replace the entries that have AVX2 or AVX-512 versions.
+void KernelsAvx2(MPIKernels* k);
+void KernelsAvx512(MPIKernels* k);
+#endif
+
+#endif
@@ -0,0 +1,14 @@
+// Generated by "make tune". Thresholds in digits.
+#ifdef MPIM_DIGIT64
+#define MUL_KARATSUBA_THRESHOLD 22
+#define MUL_TOOM3_THRESHOLD 91
+#define MUL_TOOM4_THRESHOLD 257
+#define MUL_NTT_THRESHOLD 2147483647  // never
+#define SQR_KARATSUBA_THRESHOLD 41
+#define DIV_BZ_THRESHOLD 46
+#define DIV_NEWTON_THRESHOLD 2147483647  // never
+#define DIV_EXACT_THRESHOLD 91
+#define MOD_REDC_THRESHOLD 57
+#define GCD_LEHMER_THRESHOLD 1
+#define GCD_HALF_THRESHOLD 654
+#endif
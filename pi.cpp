@@ -26,6 +26,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <cstring>
 #include "mpim.h"
 
+// Divisor of the terms, with its reciprocal made at compile time.
+constexpr MPIDivisor THOUSAND(1000);
+
+// Return a buffer of n chars holding the size chars of sz, zero past them,
+// and free sz.
+static char* Grow(char* sz, int size, int n)
+{
+    char* p = new char[n]();
+    if(sz != 0)
+    {
+        memcpy(p, sz, size);
+        delete[] sz;
+    }
+
+    return p;
+}
 
 class ArcTan
 {
@@ -69,7 +85,7 @@ public:
 
         for(int j=1; j<mExponent; ++j)
         {
-            iTerm /= 1000;
+            iTerm /= THOUSAND;
         }
 
         if(iTerm == ZERO)
@@ -84,7 +100,7 @@ public:
 
         for(int j=1; j< mExponent; ++j)
         {
-            iTerm /= 1000;
+            iTerm /= THOUSAND;
         }
 
         if(iTerm == ZERO) return mValue;
@@ -104,8 +120,9 @@ int main(int argc, char* argv[])
     ArcTan arcTanOneHalf(500);   // arctan(1/2)
     ArcTan arcTanOneFifth(200);  // arctan(1/5)
     ArcTan arcTanOneEighth(125); // arctan(1/8)
-    char sCurr[MPI_BUFF] = {0};
-    char sLast[MPI_BUFF] = {0};
+    int size = 0;       // chars in each decimal buffer
+    char* sCurr = 0;
+    char* sLast = 0;
     char *p1, *p2;
 
     // Digits found history.
@@ -128,7 +145,15 @@ int main(int argc, char* argv[])
             // Have we exceeded the resolution of the registers?
             if(mLast == mCurr) isDone = true;
 
-            strncpy(sLast, sCurr, sizeof(sLast));
+            // Keep room for the whole estimate.
+            if(mCurr.StringSize() > size)
+            {
+                sCurr = Grow(sCurr, size, mCurr.StringSize());
+                sLast = Grow(sLast, size, mCurr.StringSize());
+                size = mCurr.StringSize();
+            }
+
+            strncpy(sLast, sCurr, size);
             mCurr.String(sCurr);
 
             // Count how many chars match in the current and previous estimates.
@@ -142,7 +167,7 @@ int main(int argc, char* argv[])
             digitsFound1 = digitsFound0;
             digitsFound0 = 0;
 
-            while(*p1++ == *p2++)
+            while(*p1 != '\0' && *p1++ == *p2++)
             {
                 ++digitsFound0;
             }
@@ -156,14 +181,10 @@ int main(int argc, char* argv[])
             int digitRate = digitsFound0 - digitsFound1;
             if((digitRate >= 0) && ((digitRate == 0) || (digitRate < REPORT_ITERATIONS * 2)))
             {
-                // Copy to the display buffer only the valid chars found.
-                char sDisp[MPI_BUFF] = {0};
-                strncpy(sDisp, sCurr, digitsFound0);
-
-                // Output current result.
+                // Output current result, only the valid chars found.
                 cout << "Terms=" << i*2 << ", Digits=" << digitsFound0;
                 cout << ", Rate=" << digitRate << "\n";
-                cout << sDisp << "\n";
+                cout.write(sCurr, digitsFound0) << "\n";
                 cout.flush();
             }
             else
@@ -177,6 +198,8 @@ int main(int argc, char* argv[])
 
     cout << "Reached limit of calculation capability.\n";
 
+    delete[] sCurr;
+    delete[] sLast;
     return 0;
 }
 
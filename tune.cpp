@@ -0,0 +1,303 @@
+/******************************************************************************
+Measure multiplication thresholds for the MPIM library
+Copyright (C) 1997-2020 Norm Moulton
+
+This program times each pair of neighbouring multiplication, division,
+reduction and gcd methods on this machine, finds the operand size at which the
+faster method takes over, and writes the results to a header, by default
+mpimtune.h. "make tune" builds and runs it; the library then needs to be
+rebuilt to use the new values.
+
+
+This program is free software: you can redistribute it and/or modify it
+under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include "mpimdiv.h"
+#include "mpimkern.h"
+#include "mpimmod.h"
+#include "mpimmul.h"
+#include "mpimpool.h"
+
+using namespace std;
+
+enum
+{
+    MAX_DIGITS = 16384,      // largest operand tried
+    DIV_MAX_DIGITS = 131072, // largest divisor tried for Newton's method
+    RUNS = 5,                // timings per size, the best is kept
+    CONFIRM = 3,             // sizes in a row the faster method must win
+    NEVER = INT_MAX          // threshold for a method that never won
+};
+
+static DIGIT a[DIV_MAX_DIGITS];
+static DIGIT b[DIV_MAX_DIGITS];
+static DIGIT w[2*DIV_MAX_DIGITS];
+static DIGIT u[2*DIV_MAX_DIGITS];
+static DIGIT v[DIV_MAX_DIGITS];
+static MPI x;
+static MPI y;
+
+// Fill the operands with pseudo random digits.
+static void Fill()
+{
+    unsigned long long x = 88172645463325252ULL;
+
+    for(int i=0; i<DIV_MAX_DIGITS; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        a[i] = (DIGIT)x & DIGIT_MASK;
+
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        b[i] = (DIGIT)x & DIGIT_MASK;
+    }
+}
+
+// Set up the division of 2n digits by n: v is b normalized, and u is a
+// below b, so its top half is below v.
+static void DivSetup(int n)
+{
+    for(int i=0; i<n; ++i)
+    {
+        v[i] = b[i];
+        u[i] = a[i];
+        u[n+i] = a[i];
+    }
+
+    v[n-1] |= (DIGIT)1 << (SHIFT_VALUE-1);
+    u[2*n-1] = 0;
+}
+
+// Set x and y to the n digit values a and b.
+static void GcdSetup(int n)
+{
+    x.Reserve(n);
+    y.Reserve(n);
+    for(int i=0; i<n; ++i)
+    {
+        x.mArray[i] = a[i];
+        y.mArray[i] = b[i];
+    }
+    x.mSize = n;
+    y.mSize = n;
+    x.Normalize();
+    y.Normalize();
+}
+
+// Time f(n), in nanoseconds per call. Repeats until the clock is reliable,
+// and keeps the best of several runs.
+template<class F>
+static double Time(F f, int n)
+{
+    double best = 1e300;
+
+    for(int r=0; r<RUNS; ++r)
+    {
+        long calls = 0;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        chrono::steady_clock::duration span;
+
+        do
+        {
+            f(n);
+            ++calls;
+            span = chrono::steady_clock::now() - start;
+        }
+        while(span < chrono::milliseconds(2));
+
+        double ns = chrono::duration<double, nano>(span).count() / calls;
+        if(ns < best)
+        {
+            best = ns;
+        }
+    }
+
+    return best;
+}
+
+// Smallest size, from lo up, where fast beats slow for CONFIRM sizes in a
+// row, or NEVER if it did not by hi. Sizes grow by about an eighth each
+// step.
+template<class S, class F>
+static int Crossover(const char* name, int lo, S slow, F fast, int hi = MAX_DIGITS)
+{
+    int found = 0;
+    int wins = 0;
+
+    for(int n=lo; n<=hi; n+=(n/8 > 0 ? n/8 : 1))
+    {
+        double ts = Time(slow, n);
+        double tf = Time(fast, n);
+
+        printf("%-12s %6d digits: %12.0f ns %12.0f ns\n", name, n, ts, tf);
+
+        if(tf < ts)
+        {
+            if(wins++ == 0)
+            {
+                found = n;
+            }
+            if(wins == CONFIRM)
+            {
+                return found;
+            }
+        }
+        else
+        {
+            wins = 0;
+        }
+    }
+
+    return NEVER;
+}
+
+// Write one threshold, marking the methods that never won.
+static void Define(FILE* f, const char* name, int n)
+{
+    fprintf(f, "#define %s %d%s\n", name, n, (n == NEVER) ? "  // never" : "");
+}
+
+int main(int argc, char* argv[])
+{
+    const char* path = (argc > 1) ? argv[1] : "mpimtune.h";
+
+    Fill();
+
+    // Each method against the one below it, with the smaller products
+    // using the thresholds already found. Timed on one thread.
+    SetThreadCount(1);
+    gThresholds.mMulKaratsuba = NEVER;
+    gThresholds.mMulToom3 = NEVER;
+    gThresholds.mMulToom4 = NEVER;
+    gThresholds.mMulNtt = NEVER;
+    gThresholds.mSqrKaratsuba = NEVER;
+
+    int sqrKara = Crossover("sqr kara", 8,
+        [](int n) { DigitsSqr(w, a, n); },
+        [](int n) { DigitsSqrKara(w, a, n); });
+    gThresholds.mSqrKaratsuba = sqrKara;
+
+    int kara = Crossover("karatsuba", 8,
+        [](int n) { DigitsMul(w, a, n, b, n); },
+        [](int n) { DigitsMulKara(w, a, n, b, n); });
+    gThresholds.mMulKaratsuba = kara;
+
+    int toom3 = Crossover("toom3", kara,
+        [](int n) { DigitsMulKara(w, a, n, b, n); },
+        [](int n) { DigitsMulToom3(w, a, n, b, n); });
+    gThresholds.mMulToom3 = toom3;
+
+    int toom4 = Crossover("toom4", toom3,
+        [](int n) { DigitsMulToom3(w, a, n, b, n); },
+        [](int n) { DigitsMulToom4(w, a, n, b, n); });
+    gThresholds.mMulToom4 = toom4;
+
+    int ntt = Crossover("ntt", toom3,
+        [](int n) { DigitsMulN(w, a, n, b, n); },
+        [](int n) { DigitsMulNtt(w, a, n, b, n); });
+    gThresholds.mMulNtt = ntt;
+
+    // Division of 2n digits by n, with the multiplication thresholds found.
+    gThresholds.mDivBZ = NEVER;
+    gThresholds.mDivNewton = NEVER;
+
+    int divBZ = Crossover("div bz", 8,
+        [](int n) { DivSetup(n); DigitsDivRem(w, u, 2*n, v, n); },
+        [](int n) { DivSetup(n); DigitsDivBZ(w, u, 2*n, v, n); });
+    gThresholds.mDivBZ = divBZ;
+
+    // Newton's reciprocal only wins far above the other methods, so it is
+    // searched further.
+    int divNewton = Crossover("div newton", divBZ,
+        [](int n) { DivSetup(n); DigitsDivBZ(w, u, 2*n, v, n); },
+        [](int n) { DivSetup(n); DigitsDivNewton(w, u, 2*n, v, n); },
+        DIV_MAX_DIGITS);
+
+    // Exact division of 2n-1 digits by n, one level by halves against
+    // none. Any odd divisor will do for timing.
+    int divExact = Crossover("div exact", 8,
+        [](int n) { DivSetup(n); v[0] |= 1;
+                    gThresholds.mDivExact = NEVER;
+                    DigitsDivExact(w, u, 2*n-1, v, n); },
+        [](int n) { DivSetup(n); v[0] |= 1;
+                    gThresholds.mDivExact = n;
+                    DigitsDivExact(w, u, 2*n-1, v, n); });
+
+    // Montgomery product of n digits, multiplied and reduced in one pass
+    // against a product reduced by two more. Any odd modulus and inverse
+    // will do for timing.
+    int modRedc = Crossover("mod redc", 8,
+        [](int n) { DivSetup(n); v[0] |= 1;
+                    gThresholds.mModRedc = NEVER;
+                    DigitsMontMul(w, a, u, v, n, b, n); },
+        [](int n) { DivSetup(n); v[0] |= 1;
+                    gThresholds.mModRedc = n;
+                    DigitsMontMul(w, a, u, v, n, b, n); });
+
+    // Gcd of two n digit values, by the method above each threshold
+    // against the one below it.
+    gThresholds.mGcdHalf = NEVER;
+
+    int gcdLehmer = Crossover("gcd lehmer", 1,
+        [](int n) { GcdSetup(n); gThresholds.mGcdLehmer = NEVER;
+                    x.GCD(y); },
+        [](int n) { GcdSetup(n); gThresholds.mGcdLehmer = n;
+                    x.GCD(y); });
+    gThresholds.mGcdLehmer = gcdLehmer;
+
+    int gcdHalf = Crossover("gcd half", 64,
+        [](int n) { GcdSetup(n); gThresholds.mGcdHalf = NEVER;
+                    x.GCD(y); },
+        [](int n) { GcdSetup(n); gThresholds.mGcdHalf = n;
+                    x.GCD(y); });
+
+    FILE* f = fopen(path, "w");
+    if(f == 0)
+    {
+        perror(path);
+        return 1;
+    }
+
+#ifdef MPIM_DIGIT30
+    const char* backend = "MPIM_DIGIT30";
+#else
+    const char* backend = "MPIM_DIGIT64";
+#endif
+
+    fprintf(f, "// Generated by \"make tune\". Thresholds in digits.\n");
+    fprintf(f, "#ifdef %s\n", backend);
+    Define(f, "MUL_KARATSUBA_THRESHOLD", kara);
+    Define(f, "MUL_TOOM3_THRESHOLD", toom3);
+    Define(f, "MUL_TOOM4_THRESHOLD", toom4);
+    Define(f, "MUL_NTT_THRESHOLD", ntt);
+    Define(f, "SQR_KARATSUBA_THRESHOLD", sqrKara);
+    Define(f, "DIV_BZ_THRESHOLD", divBZ);
+    Define(f, "DIV_NEWTON_THRESHOLD", divNewton);
+    Define(f, "DIV_EXACT_THRESHOLD", divExact);
+    Define(f, "MOD_REDC_THRESHOLD", modRedc);
+    Define(f, "GCD_LEHMER_THRESHOLD", gcdLehmer);
+    Define(f, "GCD_HALF_THRESHOLD", gcdHalf);
+    fprintf(f, "#endif\n");
+    fclose(f);
+
+    printf("Wrote %s\n", path);
+    return 0;
+}